@@ -0,0 +1,100 @@
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include "backlight.h"
+#include "backlight_pwm.h"
+#include "tick.h"
+
+#if BACKLIGHT_LEVELS != 15
+#error "backlight_gamma has 16 entries, regenerate it for the new BACKLIGHT_LEVELS"
+#endif
+
+/* 0xFFFF * (level / 15) ^ 2.2 */
+static const uint16_t backlight_gamma[BACKLIGHT_LEVELS + 1] PROGMEM = {
+      0,   169,   779,  1900,  3578,  5845,  8730, 12254,
+  16439, 21301, 26858, 33124, 40112, 47835, 56306, 65535
+};
+
+#ifdef SUSPEND_BREATHING
+#define BREATHING_STEPS 128
+
+/* Rising half of a breath, 0xFFFF * ((1 - cos(pi * i / 63)) / 2) ^ 2.2,
+ * played forward then backward */
+static const uint16_t breathing_table[BREATHING_STEPS / 2] PROGMEM = {
+      0,     0,     0,     1,     3,     7,    15,    30,
+     53,    88,   139,   209,   303,   427,   584,   780,
+   1022,  1314,  1663,  2074,  2553,  3104,  3734,  4446,
+   5246,  6136,  7119,  8198,  9375, 10650, 12023, 13492,
+  15057, 16713, 18458, 20286, 22191, 24166, 26204, 28297,
+  30434, 32606, 34802, 37011, 39221, 41419, 43593, 45730,
+  47818, 49844, 51794, 53658, 55422, 57076, 58607, 60007,
+  61266, 62375, 63326, 64114, 64733, 65177, 65445, 65535
+};
+
+static volatile bool breathing;
+static uint8_t phase;
+#endif
+
+// Duty 0 still lets a one clock pulse through in fast PWM, so the output is
+// disconnected instead
+static void set_duty(uint16_t duty) {
+  if (duty) {
+    OCR1C = duty;
+    TCCR1A |= _BV(COM1C1);
+  } else {
+    TCCR1A &= ~_BV(COM1C1);
+    PORTB &= ~_BV(PB7);
+  }
+}
+
+#ifdef SUSPEND_BREATHING
+static void breathing_task(void) {
+  uint8_t i = phase < BREATHING_STEPS / 2 ? phase : BREATHING_STEPS - 1 - phase;
+
+  if (!breathing) {
+    return;
+  }
+  set_duty(pgm_read_word(&breathing_table[i]));
+  phase = (phase + 1) & (BREATHING_STEPS - 1);
+}
+#endif
+
+void backlight_pwm_init(void) {
+#ifdef SUSPEND_BREATHING
+  tick_task_add(breathing_task, BACKLIGHT_BREATHING_PERIOD * 1000UL / BREATHING_STEPS);
+#endif
+}
+
+// Replaces the shift based levels of quantum.c
+void backlight_set(uint8_t level) {
+  if (level > BACKLIGHT_LEVELS) {
+    level = BACKLIGHT_LEVELS;
+  }
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+#ifdef SUSPEND_BREATHING
+    breathing = false;
+#endif
+    set_duty(pgm_read_word(&backlight_gamma[level]));
+  }
+}
+
+#ifdef SUSPEND_BREATHING
+void backlight_breathing_start(void) {
+  if (!breathing) {
+    phase = 0;
+    breathing = true;
+  }
+}
+
+// Called over and over while the host is suspended. Power down would stop
+// timer 3 and the breathing with it, so SUSPEND_BREATHING turns core's off in
+// config.h and the CPU idles until the next interrupt instead.
+void suspend_power_down_user(void) {
+  backlight_breathing_start();
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
+  sleep_cpu();
+  sleep_disable();
+}
+#endif
@@ -0,0 +1,32 @@
+#ifndef BACKLIGHT_PWM_H
+#define BACKLIGHT_PWM_H
+
+#include "quantum.h"
+
+/*
+ * Backlight levels and suspend breathing
+ *
+ * The backlight stays on the timer 1 PWM quantum sets up on B7, so it never
+ * competes with the tick service for a timer. Levels map to duty through a
+ * gamma table. By default core's suspend power down turns the backlight off
+ * and stops the CPU until the host wakes it.
+ *
+ * With SUSPEND_BREATHING in config.h, a tick task walks OCR1C along a gamma
+ * corrected sine while the host is suspended instead. Any backlight_set(),
+ * such as the one restoring the level on wakeup, stops the breathing. Power
+ * down would set the backlight to 0 on every pass and stop timer 3, so
+ * NO_SUSPEND_POWER_DOWN comes with it and the CPU idles between ticks: the
+ * board keeps drawing milliamps through the suspend, LEDs aside.
+ */
+
+/* One full breath */
+#ifndef BACKLIGHT_BREATHING_PERIOD
+#define BACKLIGHT_BREATHING_PERIOD  4000
+#endif
+
+void backlight_pwm_init(void);
+#ifdef SUSPEND_BREATHING
+void backlight_breathing_start(void);
+#endif
+
+#endif
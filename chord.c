@@ -0,0 +1,277 @@
+#include "chord.h"
+#include "matrix_ring.h"
+#include "action_layer.h"
+#include "keymap.h"
+#include "util.h"
+
+#define SET_BYTES       ((CHORD_BITS + 7) / 8)
+
+static uint8_t held[SET_BYTES];
+static uint8_t layer_members[SET_BYTES];
+static uint8_t key_members[SET_BYTES];
+static uint32_t active;                 // layer chords turned on, by index
+static bool passthrough;
+
+// Key chord presses held back, oldest first
+static keyrecord_t waiting[CHORD_SIZE];
+static uint8_t waiting_len;
+static uint16_t waiting_time;
+static bool replaying;
+
+// Last key chord sent, until one of its keys goes up
+static uint8_t fired[CHORD_SIZE];
+static uint8_t fired_code;
+
+static bool test(const uint8_t *set, uint8_t bit) {
+  return set[bit >> 3] & (1 << (bit & 7));
+}
+
+static void assign(uint8_t *set, uint8_t bit, bool on) {
+  if (on) {
+    set[bit >> 3] |= 1 << (bit & 7);
+  } else {
+    set[bit >> 3] &= ~(1 << (bit & 7));
+  }
+}
+
+static void read_chord(uint8_t index, chord_t *chord) {
+  memcpy_P(chord, &chords[index], sizeof(chord_t));
+}
+
+static uint8_t chord_count(void) {
+  return pgm_read_byte(&chords_len);
+}
+
+// Index of the first chord whose lowest bit is bit or more
+static uint8_t first_chord(uint8_t bit) {
+  uint8_t lo = 0;
+  uint8_t hi = chord_count();
+
+  while (lo < hi) {
+    uint8_t mid = (lo + hi) / 2;
+
+    if (pgm_read_byte(&chords[mid].bits[0]) < bit) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static bool all_held(const chord_t *chord) {
+  for (uint8_t i = 0; i < CHORD_SIZE; i++) {
+    if (chord->bits[i] && !test(held, chord->bits[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static uint8_t key_bit(keyrecord_t *record) {
+  return CHORD_KEY_BIT(record->event.key.row, record->event.key.col);
+}
+
+// Key chords are laid out on the default layer: a key that another layer has
+// taken over goes straight through instead of waiting for its partners
+static bool key_member(uint16_t keycode, keyrecord_t *record) {
+  return !passthrough && test(key_members, key_bit(record)) &&
+         keycode == keymap_key_to_keycode(biton32(default_layer_state), record->event.key);
+}
+
+void chord_init(void) {
+  chord_t chord;
+
+  for (uint8_t i = 0; i < chord_count(); i++) {
+    read_chord(i, &chord);
+    for (uint8_t j = 0; j < CHORD_SIZE; j++) {
+      if (chord.bits[j]) {
+        assign(chord.kind == CHORD_LAYER_ON ? layer_members : key_members, chord.bits[j], true);
+      }
+    }
+  }
+}
+
+// A chord completed by a press starts on a held layer chord bit, so only the
+// chords starting on those are looked at
+static void layers_pressed(void) {
+  chord_t chord;
+
+  for (uint8_t bit = 1; bit < CHORD_BITS; bit++) {
+    if (!(held[bit >> 3] & layer_members[bit >> 3])) {
+      bit |= 7;
+      continue;
+    }
+    if (!test(held, bit) || !test(layer_members, bit)) {
+      continue;
+    }
+    for (uint8_t i = first_chord(bit); i < chord_count(); i++) {
+      read_chord(i, &chord);
+      if (chord.bits[0] != bit) {
+        break;
+      }
+      if (chord.kind == CHORD_LAYER_ON && !(active & (1UL << i)) && all_held(&chord)) {
+        active |= 1UL << i;
+        layer_on(chord.value);
+      }
+    }
+  }
+}
+
+static void layers_released(void) {
+  chord_t chord;
+
+  for (uint8_t i = 0; i < CHORD_MAX && active >> i; i++) {
+    if (!(active & (1UL << i))) {
+      continue;
+    }
+    read_chord(i, &chord);
+    if (!all_held(&chord)) {
+      active &= ~(1UL << i);
+      layer_off(chord.value);
+    }
+  }
+}
+
+static bool waiting_has(uint8_t bit) {
+  for (uint8_t i = 0; i < waiting_len; i++) {
+    if (key_bit(&waiting[i]) == bit) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The held back presses make up a whole key chord, which has to start on the
+// lowest of them
+static bool complete(chord_t *chord) {
+  uint8_t low = CHORD_BITS;
+
+  for (uint8_t i = 0; i < waiting_len; i++) {
+    if (key_bit(&waiting[i]) < low) {
+      low = key_bit(&waiting[i]);
+    }
+  }
+  for (uint8_t i = first_chord(low); i < chord_count(); i++) {
+    uint8_t size = 0;
+    bool match = true;
+
+    read_chord(i, chord);
+    if (chord->bits[0] != low) {
+      break;
+    }
+    for (uint8_t j = 0; j < CHORD_SIZE && chord->bits[j]; j++) {
+      match = match && waiting_has(chord->bits[j]);
+      size++;
+    }
+    if (chord->kind == CHORD_KEYCODE && match && size == waiting_len) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void fire(chord_t *chord) {
+  if (fired_code) {
+    unregister_code(fired_code);
+  }
+  register_code(chord->value);
+  fired_code = chord->value;
+  memcpy(fired, chord->bits, CHORD_SIZE);
+  waiting_len = 0;
+}
+
+// Sends the chord's release with the first of its keys to go up, and
+// swallows the release of every one of them
+static bool fired_release(uint8_t bit) {
+  bool found = false;
+
+  for (uint8_t i = 0; i < CHORD_SIZE; i++) {
+    if (fired[i] == bit) {
+      fired[i] = 0;
+      found = true;
+    }
+  }
+  if (found && fired_code) {
+    unregister_code(fired_code);
+    fired_code = KC_NO;
+  }
+  return found;
+}
+
+// Replays the held back presses in order; they pass straight through here
+static void flush(void) {
+  keyrecord_t records[CHORD_SIZE];
+  uint8_t len = waiting_len;
+
+  memcpy(records, waiting, len * sizeof(keyrecord_t));
+  waiting_len = 0;
+
+  replaying = true;
+  for (uint8_t i = 0; i < len; i++) {
+    process_record(&records[i]);
+  }
+  replaying = false;
+}
+
+bool process_chord(uint16_t keycode, keyrecord_t *record) {
+  bool pressed = record->event.pressed;
+  uint8_t bit;
+  chord_t chord;
+
+  if (replaying) {
+    return true;
+  }
+  bit = key_bit(record);
+  assign(held, bit, pressed);
+
+  // Anything but another chord key press ends the wait, and goes after it
+  if (waiting_len && !(pressed && key_member(keycode, record))) {
+    flush();
+  }
+  if (!pressed && fired_release(bit)) {
+    return false;
+  }
+  if (pressed && key_member(keycode, record)) {
+    if (!waiting_len) {
+      waiting_time = matrix_edge_time(record->event);
+    }
+    waiting[waiting_len++] = *record;
+    if (complete(&chord)) {
+      fire(&chord);
+    } else if (waiting_len == CHORD_SIZE) {
+      flush();
+    }
+    return false;
+  }
+
+  if (IS_CHORD_ROLE(keycode)) {
+    bit = CHORD_ROLE_BIT(keycode - CHORD_ROLE_RANGE);
+    assign(held, bit, pressed);
+  } else if (!test(layer_members, bit)) {
+    return true;
+  }
+  if (pressed) {
+    layers_pressed();
+  } else {
+    layers_released();
+  }
+  return !IS_CHORD_ROLE(keycode);
+}
+
+void chord_task(void) {
+  if (waiting_len && timer_elapsed(waiting_time) >= CHORD_TERM) {
+    flush();
+  }
+}
+
+bool chord_replaying(void) {
+  return replaying;
+}
+
+void chord_passthrough(bool on) {
+  if (on) {
+    flush();
+  }
+  passthrough = on;
+}
@@ -0,0 +1,76 @@
+#ifndef CHORD_H
+#define CHORD_H
+
+#include "quantum.h"
+
+/*
+ * Chord engine
+ *
+ * Keys held down are kept as one bit each: CHORD_KEY_BIT(row, col) for the 48
+ * matrix positions, then CHORD_ROLE_BIT(n) for CR(n) keys, which do nothing
+ * but set their bit wherever they sit on the layers. A chord lists up to
+ * CHORD_SIZE bits and does one of:
+ *
+ *   CHORD_LAYER  turns the layer on while all its bits are held. Tri-layer is
+ *                {Lower, Raise} -> Nexus next to {Lower} -> Lower and
+ *                {Raise} -> Raise.
+ *   CHORD_KEY    sends the keycode instead when all its matrix keys go down
+ *                within CHORD_TERM of each other. Their presses are held back
+ *                that long at most, and replayed through process_record() when
+ *                the chord does not complete. Only keys that resolve to what
+ *                the default layer has there take part, so a layer that puts
+ *                something else on a chord key is never delayed.
+ *
+ * process_chord() goes after the tap/hold engine, so every event reaches it
+ * once and in the order tap/hold settled them.
+ *
+ * chords[] must be sorted by first bit and each chord's bits must ascend, so a
+ * press only looks at the chords starting on a key that is held, found by
+ * binary search, instead of walking the whole table.
+ */
+
+#ifndef CHORD_TERM
+#define CHORD_TERM              30
+#endif
+
+#define CHORD_SIZE              3
+#define CHORD_ROLES             8
+#define CHORD_MAX               32      // chords in the table
+
+#define CHORD_ROLE_RANGE        (SAFE_RANGE + 0x180)
+#define CR(n)                   (CHORD_ROLE_RANGE + (n))
+#define IS_CHORD_ROLE(kc)       ((kc) >= CHORD_ROLE_RANGE && (kc) < CHORD_ROLE_RANGE + CHORD_ROLES)
+
+/* Bit 0 is no key, so unused chord slots can be left out */
+#define CHORD_KEY_BIT(row, col) (1 + (row) * MATRIX_COLS + (col))
+#define CHORD_ROLE_BIT(n)       (1 + MATRIX_ROWS * MATRIX_COLS + (n))
+#define CHORD_BITS              CHORD_ROLE_BIT(CHORD_ROLES)
+
+enum chord_kinds {
+  CHORD_LAYER_ON,
+  CHORD_KEYCODE,
+};
+
+typedef struct {
+  uint8_t bits[CHORD_SIZE];
+  uint8_t kind;
+  uint8_t value;                        // layer or basic keycode
+} chord_t;
+
+#define CHORD_LAYER(layer, ...) { { __VA_ARGS__ }, CHORD_LAYER_ON, (layer) }
+#define CHORD_KEY(kc, ...)      { { __VA_ARGS__ }, CHORD_KEYCODE, (kc) }
+
+extern const chord_t chords[];
+extern const uint8_t chords_len;
+
+void chord_init(void);
+bool process_chord(uint16_t keycode, keyrecord_t *record);
+void chord_task(void);
+
+/* Turns CHORD_KEY chords off, so no press is ever held back */
+void chord_passthrough(bool on);
+
+/* True while held back presses are replayed through process_record() */
+bool chord_replaying(void);
+
+#endif
@@ -44,12 +44,32 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /* define if matrix has ghost */
 //#define MATRIX_HAS_GHOST
 
-/* number of backlight levels */
-#define BACKLIGHT_LEVELS 3
+/* number of backlight levels, see backlight_gamma in backlight_pwm.c */
+#define BACKLIGHT_LEVELS 15
+
+/* Breathe the backlight while the host is suspended (see backlight_pwm.h). The
+ * CPU then idles instead of powering down so that timer 3 keeps running, which
+ * with the LEDs lit draws well over the 2.5 mA USB allows a suspended device. */
+//#define SUSPEND_BREATHING
+
+#ifdef SUSPEND_BREATHING
+#define NO_SUSPEND_POWER_DOWN
+#endif
 
 /* Set 0 if debouncing isn't needed */
 #define DEBOUNCING_DELAY 5
 
+/* Debounce each key on its own: presses are reported on the first sample,
+ * releases once the key has read released for DEBOUNCING_DELAY ms. Comment out
+ * to wait for the whole matrix to be quiet for DEBOUNCING_DELAY instead. */
+#define DEBOUNCE_EAGER
+
+/* With no key down the matrix is probed with all rows low after
+ * MATRIX_IDLE_MS, and the main loop sleeps between interrupts after
+ * MATRIX_SLEEP_MS. See the scan modes in matrix_ring.h. */
+#define MATRIX_IDLE_MS  1000
+#define MATRIX_SLEEP_MS 10000
+
 /* Mechanical locking support. Use KC_LCAP, KC_LNUM or KC_LSCR instead in keymap */
 #define LOCKING_SUPPORT_ENABLE
 /* Locking resynchronize hack */
@@ -60,9 +80,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
     keyboard_report->mods == (MOD_BIT(KC_LSHIFT) | MOD_BIT(KC_RSHIFT)) \
 )
 
+/* Core keeps the source layer of every key as bit-planes, 5 bits a key (30
+ * bytes). The 16 layers here would fit 4, but MAX_LAYER_BITS is fixed by
+ * action_layer.h in this QMK version. */
 #define PREVENT_STUCK_MODIFIERS
 #define TAPPING_TERM    200
 
+/* Dual-role keys flagged TH_TYPING_STREAK tap at once when pressed this soon
+ * after a regular key */
+#define TAP_HOLD_STREAK_TERM 100
+
+/* Mouse keys report every MOUSE_MOTION_INTERVAL ms while moving, no faster than
+ * the 10 ms the mouse endpoint is polled at, and ramp up one step of the
+ * acceleration curve every MOUSE_MOTION_STEP ms */
+#define MOUSE_MOTION_INTERVAL 10
+#define MOUSE_MOTION_STEP     40
+
+/* Room for a whole settings blob, see settings.h */
+#define EEPROM_CACHE_SIZE 8
+
+/* Both Alts pressed together within CHORD_TERM send Menu. Off by default: every
+ * Alt press, AltGr for the BR_* keys included, waits up to CHORD_TERM to see
+ * whether the other one follows. */
+//#define ALT_MENU_CHORD
+
+/* Key tapped before Caps Lock when ESC_CPL is double tapped, to take back the
+ * Esc already sent by the first tap. KC_NO leaves the Esc in place. */
+#define ESC_CAPS_UNDO   KC_NO
+
 /*
  * Feature disable options
  *  These options are also useful to firmware size reduction.
@@ -0,0 +1,85 @@
+#include "dead_key.h"
+
+#define QUEUE_MASK      (DEAD_KEY_QUEUE_SIZE - 1)
+#define SEQ_DEAD(s)     (((s) >> 8) & 0x7F)
+#define SEQ_SHIFT(s)    ((s) & 0x8000)
+#define SEQ_LETTER(s)   ((s) & 0xFF)
+
+enum {
+  STEP_DEAD_DOWN,
+  STEP_DEAD_UP,
+  STEP_LETTER_DOWN,
+  STEP_LETTER_UP,
+};
+
+static uint8_t queue[DEAD_KEY_QUEUE_SIZE];
+static uint8_t head;
+static uint8_t tail;
+static uint8_t step;
+
+bool process_dead_key(uint16_t keycode, keyrecord_t *record) {
+  if (!IS_DEAD_KEY(keycode)) {
+    return true;
+  }
+  if (record->event.pressed) {
+    uint8_t next = (head + 1) & QUEUE_MASK;
+
+    if (next != tail) {
+      queue[head] = keycode - DEAD_KEY_RANGE;
+      head = next;
+    }
+  }
+  return false;
+}
+
+// Sends the dead key with only the mods it needs. The real mods are put back
+// before returning, so keys handled in between still see the user's Shift.
+static void send_dead(uint8_t kc, uint8_t mods, bool pressed) {
+  uint8_t real = get_mods();
+
+  set_mods(mods);
+  if (pressed) {
+    add_key(kc);
+  } else {
+    del_key(kc);
+  }
+  send_keyboard_report();
+  set_mods(real);
+}
+
+// Sends the next report of the oldest sequence
+static void step_once(void) {
+  uint16_t seq = pgm_read_word(&dead_key_seqs[queue[tail]]);
+
+  if (step == STEP_DEAD_DOWN && SEQ_DEAD(seq) == KC_NO) {
+    step = STEP_LETTER_DOWN;
+  }
+  switch (step) {
+    case STEP_DEAD_DOWN:
+    case STEP_DEAD_UP:
+      send_dead(SEQ_DEAD(seq), SEQ_SHIFT(seq) ? MOD_BIT(KC_LSFT) : 0, step == STEP_DEAD_DOWN);
+      step++;
+      break;
+    case STEP_LETTER_DOWN:
+      register_code(SEQ_LETTER(seq));
+      step++;
+      break;
+    case STEP_LETTER_UP:
+      unregister_code(SEQ_LETTER(seq));
+      step = STEP_DEAD_DOWN;
+      tail = (tail + 1) & QUEUE_MASK;
+      break;
+  }
+}
+
+void dead_key_task(void) {
+  if (head != tail) {
+    step_once();
+  }
+}
+
+void dead_key_flush(void) {
+  while (head != tail) {
+    step_once();
+  }
+}
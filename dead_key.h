@@ -0,0 +1,47 @@
+#ifndef DEAD_KEY_H
+#define DEAD_KEY_H
+
+#include "quantum.h"
+
+/*
+ * Dead key sequences for accented letters
+ *
+ * A DK(n) key types dead_key_seqs[n]: a dead key followed by a letter, for
+ * hosts set to a layout with dead keys such as ABNT2. Presses are queued and
+ * dead_key_task() sends one report per call, so a letter takes four scans
+ * (dead key down, up, letter down, up) and the main loop never waits on the
+ * host. Bursts run at a quarter of the scan rate, and no faster than the USB
+ * polling interval allows: 250 letters/s at 1 ms.
+ *
+ * The dead key goes out with only its own Shift, so holding Shift or Caps Lock
+ * capitalises the letter without turning ~ into ^.
+ *
+ * Any other key event has to wait for the queue: a key sent between a dead key
+ * and its letter would be composed with the dead key by the host. Before
+ * handling one, process_record_user() calls dead_key_flush(), which sends the
+ * rest of the queued sequences at once. That only blocks on the host when a
+ * key is pressed within the few scans a sequence takes.
+ */
+
+/* Must be a power of two */
+#ifndef DEAD_KEY_QUEUE_SIZE
+#define DEAD_KEY_QUEUE_SIZE     8
+#endif
+
+#define DEAD_KEY_RANGE          (SAFE_RANGE + 0x140)
+#define DEAD_KEY_MAX            0x40
+#define DK(n)                   (DEAD_KEY_RANGE + (n))
+#define IS_DEAD_KEY(kc)         ((kc) >= DEAD_KEY_RANGE && (kc) < DEAD_KEY_RANGE + DEAD_KEY_MAX)
+
+/* One sequence in two bytes. dead is a basic keycode below 0x80, optionally
+ * shifted (LSFT()), or KC_NO to type the letter alone. */
+#define DEAD_KEY_SEQ(dead, letter) \
+  ((uint16_t)((((dead) & 0x7F) | (((dead) & QK_LSFT) ? 0x80 : 0)) << 8) | (letter))
+
+extern const uint16_t dead_key_seqs[];
+
+bool process_dead_key(uint16_t keycode, keyrecord_t *record);
+void dead_key_task(void);
+void dead_key_flush(void);
+
+#endif
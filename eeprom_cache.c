@@ -0,0 +1,86 @@
+#include <avr/eeprom.h>
+#include "eeprom_cache.h"
+
+typedef struct {
+  uint8_t *addr;
+  uint8_t  value;
+  bool     dirty;
+} eeprom_cache_entry_t;
+
+static eeprom_cache_entry_t entries[EEPROM_CACHE_SIZE];
+
+static uint16_t last_scan;
+
+uint16_t eeprom_cache_stalls;
+
+// Only dirty entries are in use: an entry is free again once flushed, and
+// address 0 (the eeconfig magic) is as valid as any other
+static eeprom_cache_entry_t *find_entry(const uint8_t *addr) {
+  for (uint8_t i = 0; i < EEPROM_CACHE_SIZE; i++) {
+    if (entries[i].dirty && entries[i].addr == addr) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+static eeprom_cache_entry_t *free_entry(void) {
+  for (uint8_t i = 0; i < EEPROM_CACHE_SIZE; i++) {
+    if (!entries[i].dirty) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+void eeprom_cache_write_byte(uint8_t *addr, uint8_t value) {
+  eeprom_cache_entry_t *entry = find_entry(addr);
+
+  if (!entry) {
+    entry = free_entry();
+  }
+  if (!entry) {
+    // Cache full: fall back to a blocking write rather than lose the update
+    eeprom_update_byte(addr, value);
+    return;
+  }
+  entry->addr = addr;
+  entry->value = value;
+  entry->dirty = true;
+}
+
+static bool keys_down(void) {
+  for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+    if (matrix_get_row(row)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void eeprom_cache_task(void) {
+  uint16_t now = timer_read();
+  bool ready = eeprom_is_ready();
+
+  if (!ready && TIMER_DIFF_16(now, last_scan) >= EEPROM_STALL_THRESHOLD) {
+    eeprom_cache_stalls++;
+  }
+  last_scan = now;
+
+  if (!ready || keys_down()) {
+    return;
+  }
+
+  for (uint8_t i = 0; i < EEPROM_CACHE_SIZE; i++) {
+    eeprom_cache_entry_t *entry = &entries[i];
+
+    if (!entry->dirty) {
+      continue;
+    }
+    entry->dirty = false;
+    if (eeprom_read_byte(entry->addr) != entry->value) {
+      eeprom_write_byte(entry->addr, entry->value);
+      return;
+    }
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef EEPROM_CACHE_H
+#define EEPROM_CACHE_H
+
+#include "quantum.h"
+
+/*
+ * Write-behind EEPROM cache
+ *
+ * AVR EEPROM writes take about 3.4 ms per byte, and any EEPROM access made
+ * while one is in flight spins until it completes. Writes queued here are
+ * coalesced per address and flushed one byte per scan, only while no key is
+ * down and the EEPROM is ready, and only when the stored byte differs.
+ */
+
+#ifndef EEPROM_CACHE_SIZE
+#define EEPROM_CACHE_SIZE       4
+#endif
+
+/* Scan-to-scan gap, in ms, counted as a stall when an EEPROM write is in flight */
+#ifndef EEPROM_STALL_THRESHOLD
+#define EEPROM_STALL_THRESHOLD  2
+#endif
+
+void eeprom_cache_write_byte(uint8_t *addr, uint8_t value);
+void eeprom_cache_task(void);
+
+/* Scan cycles that stalled behind an EEPROM write, from any caller; the STATS
+ * dump reads and clears it */
+extern uint16_t eeprom_cache_stalls;
+
+#endif
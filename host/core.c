@@ -0,0 +1,659 @@
+/*
+ * Stand-in for the QMK core a keymap build links against: layers with the
+ * PREVENT_STUCK_MODIFIERS source layer cache, process_record() down to the
+ * actions this keymap uses, tap dance, the keyboard report, host.c and
+ * eeconfig. It follows the core of the checkout build.sh makes closely enough
+ * to feed keymap.c and its modules, with these simplifications:
+ *
+ *  - no tapping state machine: F(n) layer tap toggles act on press and
+ *    release at once instead of buffering other keys;
+ *  - no Alt/Gui swapping, locking keys, one-shot keys or command;
+ *  - interrupts only run between main loop steps (see replay.c), so cli() and
+ *    sei() are no-ops.
+ */
+
+#include <stdio.h>
+#include "quantum.h"
+#include "host.h"
+#include "backlight.h"
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+
+#define TAPPING_TOGGLE  5
+
+extern const uint16_t keymaps[][MATRIX_ROWS][MATRIX_COLS];
+
+bool process_record_user(uint16_t keycode, keyrecord_t *record);
+void replay_key_added(keypos_t key);
+void replay_layer_lookup(uint32_t layers, keypos_t key);
+
+uint32_t default_layer_state;
+uint32_t layer_state;
+keymap_config_t keymap_config;
+backlight_config_t backlight_config;
+uint8_t keyboard_protocol = 1;
+
+static uint8_t source_layers[MATRIX_ROWS][MATRIX_COLS];
+
+static report_keyboard_t report;
+static uint8_t real_mods;
+static uint8_t weak_mods;
+
+/* Key of the process_record() call running, for replay.c to pair reports with
+ * the presses behind them */
+static keypos_t record_key;
+static bool in_record;
+
+static host_driver_t *driver;
+static uint16_t last_system;
+static uint16_t last_consumer;
+
+/* util.c */
+
+uint8_t bitpop16(uint16_t bits) {
+  return __builtin_popcount(bits);
+}
+
+uint8_t biton32(uint32_t bits) {
+  return bits ? 31 - __builtin_clz(bits) : 0;
+}
+
+/* print.c, debug output is not part of the replay */
+
+void print(const char *s) {
+  (void)s;
+}
+
+void phex(uint8_t c) {
+  (void)c;
+}
+
+void print_bin_reverse16(uint16_t bits) {
+  (void)bits;
+}
+
+/* action_layer.c, PREVENT_STUCK_MODIFIERS builds leave the keyboard alone
+ * when layers change */
+
+void default_layer_set(uint32_t state) {
+  default_layer_state = state;
+}
+
+void layer_on(uint8_t layer) {
+  layer_state |= 1UL << layer;
+}
+
+void layer_off(uint8_t layer) {
+  layer_state &= ~(1UL << layer);
+}
+
+void layer_invert(uint8_t layer) {
+  layer_state ^= 1UL << layer;
+}
+
+void layer_clear(void) {
+  layer_state = 0;
+}
+
+/* keymap_common.c */
+
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key) {
+  return pgm_read_word(&keymaps[layer][key.row][key.col]);
+}
+
+/* action_layer.c, every layer bit from the top down, whichever are in use */
+uint8_t layer_walk(uint32_t layers, keypos_t key) {
+  for (int8_t i = 31; i >= 0; i--) {
+    if ((layers & (1UL << i)) && pgm_read_word(&keymaps[i][key.row][key.col]) != KC_TRNS) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+static uint8_t layer_switch_get_layer(keypos_t key) {
+  uint32_t layers = layer_state | default_layer_state;
+
+  replay_layer_lookup(layers, key);
+  return layer_walk(layers, key);
+}
+
+/* action_util.c */
+
+uint8_t get_mods(void) {
+  return real_mods;
+}
+
+void add_mods(uint8_t mods) {
+  if (in_record && (mods & ~real_mods)) {
+    replay_key_added(record_key);
+  }
+  real_mods |= mods;
+}
+
+void del_mods(uint8_t mods) {
+  real_mods &= ~mods;
+}
+
+void set_mods(uint8_t mods) {
+  real_mods = mods;
+}
+
+static bool nkro(void) {
+#ifdef NKRO_ENABLE
+  return keyboard_protocol && keymap_config.nkro;
+#else
+  return false;
+#endif
+}
+
+void add_key(uint8_t key) {
+  if (in_record) {
+    replay_key_added(record_key);
+  }
+#ifdef NKRO_ENABLE
+  if (nkro()) {
+    if ((key >> 3) < KEYBOARD_REPORT_BITS) {
+      report.nkro.bits[key >> 3] |= 1 << (key & 7);
+    }
+    return;
+  }
+#endif
+  for (uint8_t i = 0; i < 6; i++) {
+    if (report.keys[i] == key) {
+      return;
+    }
+  }
+  for (uint8_t i = 0; i < 6; i++) {
+    if (!report.keys[i]) {
+      report.keys[i] = key;
+      return;
+    }
+  }
+}
+
+void del_key(uint8_t key) {
+#ifdef NKRO_ENABLE
+  if (nkro()) {
+    if ((key >> 3) < KEYBOARD_REPORT_BITS) {
+      report.nkro.bits[key >> 3] &= ~(1 << (key & 7));
+    }
+    return;
+  }
+#endif
+  for (uint8_t i = 0; i < 6; i++) {
+    if (report.keys[i] == key) {
+      report.keys[i] = 0;
+    }
+  }
+}
+
+void send_keyboard_report(void) {
+  report.mods = real_mods | weak_mods;
+  host_keyboard_send(&report);
+}
+
+/* host.c */
+
+void host_set_driver(host_driver_t *d) {
+  driver = d;
+}
+
+host_driver_t *host_get_driver(void) {
+  return driver;
+}
+
+void host_keyboard_send(report_keyboard_t *r) {
+  if (driver) {
+    driver->send_keyboard(r);
+  }
+}
+
+void host_mouse_send(report_mouse_t *r) {
+  if (driver) {
+    driver->send_mouse(r);
+  }
+}
+
+void host_system_send(uint16_t data) {
+  if (data == last_system) {
+    return;
+  }
+  last_system = data;
+  if (driver) {
+    driver->send_system(data);
+  }
+}
+
+void host_consumer_send(uint16_t data) {
+  if (data == last_consumer) {
+    return;
+  }
+  last_consumer = data;
+  if (driver) {
+    driver->send_consumer(data);
+  }
+}
+
+/* action.c */
+
+static uint16_t system_usage(uint8_t code) {
+  return 0x81 + (code - KC_SYSTEM_POWER);
+}
+
+static uint16_t consumer_usage(uint8_t code) {
+  static const uint16_t usages[] = {
+    0x0E2, 0x0E9, 0x0EA, 0x0B5, 0x0B6, 0x0B7, 0x0CD, 0x183, 0x0B8,
+    0x18A, 0x192, 0x194, 0x221, 0x223, 0x224, 0x225, 0x226, 0x227,
+    0x22A, 0x0B3, 0x0B4,
+  };
+  return usages[code - KC_AUDIO_MUTE];
+}
+
+void register_code(uint8_t code) {
+  if (code == KC_NO) {
+    return;
+  }
+  if (IS_KEY(code)) {
+    add_key(code);
+    send_keyboard_report();
+  } else if (IS_MOD(code)) {
+    add_mods(MOD_BIT(code));
+    send_keyboard_report();
+  } else if (IS_SYSTEM(code)) {
+    host_system_send(system_usage(code));
+  } else if (IS_CONSUMER(code)) {
+    host_consumer_send(consumer_usage(code));
+  }
+}
+
+void unregister_code(uint8_t code) {
+  if (code == KC_NO) {
+    return;
+  }
+  if (IS_KEY(code)) {
+    del_key(code);
+    send_keyboard_report();
+  } else if (IS_MOD(code)) {
+    del_mods(MOD_BIT(code));
+    send_keyboard_report();
+  } else if (IS_SYSTEM(code)) {
+    host_system_send(0);
+  } else if (IS_CONSUMER(code)) {
+    host_consumer_send(0);
+  }
+}
+
+void register_mods(uint8_t mods) {
+  if (mods) {
+    add_mods(mods);
+    send_keyboard_report();
+  }
+}
+
+void unregister_mods(uint8_t mods) {
+  if (mods) {
+    del_mods(mods);
+    send_keyboard_report();
+  }
+}
+
+void clear_keyboard(void) {
+  real_mods = 0;
+  weak_mods = 0;
+  memset(report.raw, 0, sizeof(report.raw));
+  send_keyboard_report();
+  host_system_send(0);
+  host_consumer_send(0);
+}
+
+/* eeconfig.c */
+
+bool eeconfig_is_enabled(void) {
+  return eeprom_read_word(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER;
+}
+
+void eeconfig_init(void) {
+  eeprom_update_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER);
+  eeprom_update_byte(EECONFIG_DEBUG, 0);
+  eeprom_update_byte(EECONFIG_DEFAULT_LAYER, 0);
+  eeprom_update_byte(EECONFIG_KEYMAP, 0);
+  eeprom_update_byte(EECONFIG_MOUSEKEY_ACCEL, 0);
+  eeprom_update_byte(EECONFIG_BACKLIGHT, 0);
+}
+
+uint8_t eeconfig_read_default_layer(void) {
+  return eeprom_read_byte(EECONFIG_DEFAULT_LAYER);
+}
+
+void eeconfig_update_default_layer(uint8_t val) {
+  eeprom_update_byte(EECONFIG_DEFAULT_LAYER, val);
+}
+
+uint8_t eeconfig_read_keymap(void) {
+  return eeprom_read_byte(EECONFIG_KEYMAP);
+}
+
+void eeconfig_update_keymap(uint8_t val) {
+  eeprom_update_byte(EECONFIG_KEYMAP, val);
+}
+
+uint8_t eeconfig_read_backlight(void) {
+  return eeprom_read_byte(EECONFIG_BACKLIGHT);
+}
+
+void eeconfig_update_backlight(uint8_t val) {
+  eeprom_update_byte(EECONFIG_BACKLIGHT, val);
+}
+
+/* magic.c */
+
+void magic(void) {
+  uint8_t default_layer;
+
+  if (!eeconfig_is_enabled()) {
+    eeconfig_init();
+  }
+  keymap_config.raw = eeconfig_read_keymap();
+  default_layer = eeconfig_read_default_layer();
+  default_layer_set(default_layer ? default_layer : 1UL << 0);
+}
+
+/* backlight.c */
+
+void backlight_init(void) {
+  backlight_config.raw = eeconfig_read_backlight();
+  backlight_set(backlight_config.enable ? backlight_config.level : 0);
+}
+
+static void backlight_step(int8_t step) {
+  int8_t level = backlight_config.level + step;
+
+  if (level < 0 || level > BACKLIGHT_LEVELS) {
+    return;
+  }
+  backlight_config.level = level;
+  backlight_config.enable = level != 0;
+  eeconfig_update_backlight(backlight_config.raw);
+  backlight_set(backlight_config.level);
+}
+
+static void backlight_toggle(void) {
+  backlight_config.enable = !backlight_config.enable;
+  eeconfig_update_backlight(backlight_config.raw);
+  backlight_set(backlight_config.enable ? backlight_config.level : 0);
+}
+
+/* process_tap_dance.c */
+
+static int16_t last_td = -1;
+
+static void tap_dance_finish(qk_tap_dance_action_t *action) {
+  if (!action->state.finished) {
+    action->state.finished = true;
+    if (action->fn.on_dance_finished) {
+      action->fn.on_dance_finished(&action->state, action->user_data);
+    }
+  }
+  if (!action->state.pressed) {
+    if (action->fn.on_reset) {
+      action->fn.on_reset(&action->state, action->user_data);
+    }
+    action->state.count = 0;
+    action->state.finished = false;
+    action->state.interrupted = false;
+    last_td = -1;
+  }
+}
+
+static bool process_tap_dance(uint16_t keycode, keyrecord_t *record) {
+  qk_tap_dance_action_t *action;
+
+  if (keycode < QK_TAP_DANCE || keycode > QK_TAP_DANCE_MAX) {
+    if (record->event.pressed && last_td >= 0 && tap_dance_actions[last_td].state.count) {
+      tap_dance_actions[last_td].state.interrupted = true;
+      tap_dance_finish(&tap_dance_actions[last_td]);
+    }
+    return true;
+  }
+
+  action = &tap_dance_actions[keycode - QK_TAP_DANCE];
+  action->state.pressed = record->event.pressed;
+  if (record->event.pressed) {
+    if (last_td >= 0 && last_td != keycode - QK_TAP_DANCE) {
+      tap_dance_actions[last_td].state.interrupted = true;
+      tap_dance_finish(&tap_dance_actions[last_td]);
+    }
+    action->state.keycode = keycode;
+    action->state.count++;
+    action->state.timer = timer_read();
+    if (action->fn.on_each_tap) {
+      action->fn.on_each_tap(&action->state, action->user_data);
+    }
+    last_td = keycode - QK_TAP_DANCE;
+  } else if (action->state.finished) {
+    tap_dance_finish(action);
+  }
+  return false;
+}
+
+static void matrix_scan_tap_dance(void) {
+  qk_tap_dance_action_t *action;
+
+  if (last_td < 0) {
+    return;
+  }
+  action = &tap_dance_actions[last_td];
+  if (action->state.count && !action->state.finished &&
+      timer_elapsed(action->state.timer) > TAPPING_TERM) {
+    tap_dance_finish(action);
+  }
+}
+
+/* quantum.c */
+
+void matrix_init_quantum(void) {
+  matrix_init_kb();
+}
+
+void matrix_scan_quantum(void) {
+  matrix_scan_tap_dance();
+  matrix_scan_kb();
+}
+
+__attribute__ ((weak))
+bool process_record_kb(uint16_t keycode, keyrecord_t *record) {
+  return process_record_user(keycode, record);
+}
+
+static bool process_record_quantum(uint16_t keycode, keyrecord_t *record) {
+  if (!(process_record_kb(keycode, record) && process_tap_dance(keycode, record))) {
+    return false;
+  }
+  if (!record->event.pressed) {
+    return true;
+  }
+  switch (keycode) {
+    case RESET:
+      printf("# reset\n");
+      return false;
+    case MAGIC_SWAP_ALT_GUI:
+    case MAGIC_UNSWAP_ALT_GUI:
+      keymap_config.swap_lalt_lgui = keymap_config.swap_ralt_rgui = keycode == MAGIC_SWAP_ALT_GUI;
+      eeconfig_update_keymap(keymap_config.raw);
+      return false;
+    case BL_DEC:
+      backlight_step(-1);
+      return false;
+    case BL_INC:
+      backlight_step(1);
+      return false;
+    case BL_TOGG:
+      backlight_toggle();
+      return false;
+  }
+  return true;
+}
+
+static void mods_key(uint16_t keycode, bool pressed) {
+  uint8_t mods = (keycode >> 8) & 0x1F;
+
+  mods = mods & 0x10 ? (mods & 0x0F) << 4 : mods;
+  if (pressed) {
+    weak_mods |= mods;
+    send_keyboard_report();
+    register_code(keycode);
+  } else {
+    unregister_code(keycode);
+    weak_mods &= ~mods;
+    send_keyboard_report();
+  }
+}
+
+// ACTION_LAYER_TAP_TOGGLE, without the tapping state machine: every press
+// turns the layer on for as long as it is held, and the fifth tap in a row
+// leaves it on
+static void layer_tap_toggle(uint8_t layer, keyrecord_t *record) {
+  static uint16_t last_time;
+  static uint8_t taps;
+
+  if (record->event.pressed) {
+    if (TIMER_DIFF_16(record->event.time, last_time) > TAPPING_TERM) {
+      taps = 0;
+    }
+    if (taps < TAPPING_TOGGLE) {
+      layer_invert(layer);
+    }
+  } else {
+    if (TIMER_DIFF_16(record->event.time, last_time) <= TAPPING_TERM) {
+      taps++;
+    } else {
+      taps = 0;
+    }
+    if (taps <= TAPPING_TOGGLE) {
+      layer_invert(layer);
+    }
+  }
+  last_time = record->event.time;
+}
+
+static void process_action(uint16_t keycode, keyrecord_t *record) {
+  bool pressed = record->event.pressed;
+
+  if (keycode <= 0xFF) {
+    if (IS_FN(keycode)) {
+      uint16_t action = pgm_read_word(&fn_actions[keycode - KC_FN0]);
+
+      layer_tap_toggle((action >> 8) & 0x1F, record);
+    } else if (pressed) {
+      register_code(keycode);
+    } else {
+      unregister_code(keycode);
+    }
+  } else if (keycode <= QK_MODS_MAX) {
+    mods_key(keycode, pressed);
+  } else if (keycode >= QK_FUNCTION && keycode <= QK_FUNCTION_MAX) {
+    layer_tap_toggle((pgm_read_word(&fn_actions[keycode & 0xFF]) >> 8) & 0x1F, record);
+  } else if (keycode >= QK_MOMENTARY && keycode <= QK_MOMENTARY_MAX) {
+    if (pressed) {
+      layer_on(keycode & 0xFF);
+    } else {
+      layer_off(keycode & 0xFF);
+    }
+  } else if (keycode >= QK_TOGGLE_LAYER && keycode <= QK_TOGGLE_LAYER_MAX) {
+    if (!pressed) {
+      layer_invert(keycode & 0xFF);
+    }
+  }
+}
+
+void process_record(keyrecord_t *record) {
+  keypos_t key = record->event.key;
+  keypos_t outer_key = record_key;
+  bool outer = in_record;
+  uint8_t layer;
+  uint16_t keycode;
+
+  if (record->event.pressed) {
+    layer = layer_switch_get_layer(key);
+    source_layers[key.row][key.col] = layer;
+  } else {
+    layer = source_layers[key.row][key.col];
+  }
+  keycode = keymap_key_to_keycode(layer, key);
+
+  record_key = key;
+  in_record = true;
+  if (process_record_quantum(keycode, record)) {
+    process_action(keycode, record);
+  }
+  record_key = outer_key;
+  in_record = outer;
+}
+
+/* keyboard.c */
+
+static matrix_row_t matrix_prev[MATRIX_ROWS];
+
+void keyboard_init(void) {
+  matrix_init();
+  magic();
+#ifdef BACKLIGHT_ENABLE
+  backlight_init();
+#endif
+}
+
+// One key per call, as tmk does
+void keyboard_task(void) {
+  matrix_scan();
+  for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+    matrix_row_t row = matrix_get_row(r);
+    matrix_row_t change = row ^ matrix_prev[r];
+
+    for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+      matrix_row_t bit = (matrix_row_t)1 << c;
+
+      if (change & bit) {
+        keyrecord_t record = {
+          .event = {
+            .key = { .col = c, .row = r },
+            .pressed = row & bit,
+            .time = timer_read() | 1,
+          },
+        };
+        process_record(&record);
+        matrix_prev[r] ^= bit;
+        return;
+      }
+    }
+  }
+}
+
+/* suspend.c */
+
+__attribute__ ((weak))
+void suspend_power_down_user(void) {
+}
+
+__attribute__ ((weak))
+void suspend_wakeup_init_user(void) {
+}
+
+void suspend_power_down(void) {
+  suspend_power_down_user();
+#ifndef NO_SUSPEND_POWER_DOWN
+#ifdef BACKLIGHT_ENABLE
+  backlight_set(0);
+#endif
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_cpu();
+#endif
+}
+
+void suspend_wakeup_init(void) {
+  clear_keyboard();
+#ifdef BACKLIGHT_ENABLE
+  backlight_init();
+#endif
+  suspend_wakeup_init_user();
+}
@@ -0,0 +1,3 @@
+/* Included after ../config.h: debounce the whole matrix at once, as before
+ * DEBOUNCE_EAGER */
+#undef DEBOUNCE_EAGER
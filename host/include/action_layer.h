@@ -0,0 +1,6 @@
+#ifndef HOST_ACTION_LAYER_H
+#define HOST_ACTION_LAYER_H
+
+#include "quantum.h"
+
+#endif
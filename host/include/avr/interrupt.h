@@ -0,0 +1,11 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+/* Interrupts only run between main loop steps here, see core.c */
+#define ISR(vector)             void vector(void)
+#define cli()
+#define sei()
+
+void TIMER3_COMPA_vect(void);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+/* The I/O space is a plain array; core.c drives the column pins from the
+ * replayed key states and counts timer 3 from OCR3A */
+extern volatile uint8_t io_space[0x40];
+
+#define _SFR_IO8(addr)          io_space[addr]
+#define _BV(bit)                (1 << (bit))
+
+#define PORTB                   _SFR_IO8(0x05)
+#define PB7                     7
+
+extern volatile uint8_t SREG;
+extern volatile uint8_t MCUCR;
+extern volatile uint8_t TCNT0;
+extern volatile uint8_t TCCR1A;
+extern volatile uint16_t OCR1C;
+extern volatile uint8_t TCCR3A;
+extern volatile uint8_t TCCR3B;
+extern volatile uint16_t TCNT3;
+extern volatile uint16_t OCR3A;
+extern volatile uint8_t TIMSK3;
+extern volatile uint8_t TIFR3;
+
+#define JTD                     7
+#define COM1C1                  3
+#define WGM32                   3
+#define CS31                    1
+#define CS30                    0
+#define OCIE3A                  1
+#define OCF3A                   1
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#define SLEEP_MODE_IDLE         0
+#define SLEEP_MODE_PWR_DOWN     2
+
+#define set_sleep_mode(mode)    (sleep_mode_set = (mode))
+#define sleep_enable()
+#define sleep_disable()
+
+extern unsigned char sleep_mode_set;
+
+/* Runs the interrupts up to the next one that wakes the CPU */
+void sleep_cpu(void);
+
+#endif
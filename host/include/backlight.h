@@ -0,0 +1,17 @@
+#ifndef BACKLIGHT_H
+#define BACKLIGHT_H
+
+#include "quantum.h"
+
+typedef union {
+  uint8_t raw;
+  struct {
+    bool    enable :1;
+    uint8_t level  :7;
+  };
+} backlight_config_t;
+
+void backlight_init(void);
+void backlight_set(uint8_t level);
+
+#endif
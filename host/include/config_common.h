@@ -0,0 +1,35 @@
+#ifndef CONFIG_DEFINITIONS_H
+#define CONFIG_DEFINITIONS_H
+
+/* Pin names hold the I/O address of PINx in the high nibble and the bit in the
+ * low one; DDRx and PORTx follow PINx */
+#define COL2ROW 0
+#define ROW2COL 1
+
+#define B0 0x30
+#define B1 0x31
+#define B2 0x32
+#define B3 0x33
+#define B4 0x34
+#define B5 0x35
+#define B6 0x36
+#define B7 0x37
+#define C6 0x66
+#define C7 0x67
+#define D0 0x90
+#define D1 0x91
+#define D2 0x92
+#define D3 0x93
+#define D4 0x94
+#define D5 0x95
+#define D6 0x96
+#define D7 0x97
+#define E6 0xC6
+#define F0 0xF0
+#define F1 0xF1
+#define F4 0xF4
+#define F5 0xF5
+#define F6 0xF6
+#define F7 0xF7
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_EECONFIG_H
+#define HOST_EECONFIG_H
+
+#include "quantum.h"
+
+#endif
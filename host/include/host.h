@@ -0,0 +1,18 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include "quantum.h"
+#include "host_driver.h"
+
+/* 1 for the report protocol, 0 for boot */
+extern uint8_t keyboard_protocol;
+
+void host_set_driver(host_driver_t *driver);
+host_driver_t *host_get_driver(void);
+
+void host_keyboard_send(report_keyboard_t *report);
+void host_mouse_send(report_mouse_t *report);
+void host_system_send(uint16_t data);
+void host_consumer_send(uint16_t data);
+
+#endif
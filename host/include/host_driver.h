@@ -0,0 +1,15 @@
+#ifndef HOST_DRIVER_H
+#define HOST_DRIVER_H
+
+#include <stdint.h>
+#include "report.h"
+
+typedef struct {
+  uint8_t (*keyboard_leds)(void);
+  void (*send_keyboard)(report_keyboard_t *);
+  void (*send_mouse)(report_mouse_t *);
+  void (*send_system)(uint16_t);
+  void (*send_consumer)(uint16_t);
+} host_driver_t;
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_KEYMAP_H
+#define HOST_KEYMAP_H
+
+#include "quantum.h"
+
+#endif
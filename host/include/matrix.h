@@ -0,0 +1,6 @@
+#ifndef HOST_MATRIX_H
+#define HOST_MATRIX_H
+
+#include "quantum.h"
+
+#endif
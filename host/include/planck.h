@@ -0,0 +1,6 @@
+#ifndef HOST_PLANCK_H
+#define HOST_PLANCK_H
+
+#include "quantum.h"
+
+#endif
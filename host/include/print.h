@@ -0,0 +1,6 @@
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include "quantum.h"
+
+#endif
@@ -0,0 +1,549 @@
+#ifndef QUANTUM_H
+#define QUANTUM_H
+
+/*
+ * Stand-in for the parts of QMK core the keymap sources use, for the host
+ * harness only. Keycode values, report layouts and function names follow the
+ * QMK version build.sh checks out, so keymap.c and its modules compile here
+ * unchanged; behaviour lives in core.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+/* keyboard.h */
+typedef struct {
+  uint8_t col;
+  uint8_t row;
+} keypos_t;
+
+typedef struct {
+  keypos_t key;
+  bool     pressed;
+  uint16_t time;
+} keyevent_t;
+
+#define KEYEQ(keya, keyb)       ((keya).row == (keyb).row && (keya).col == (keyb).col)
+
+/* action.h */
+typedef struct {
+  bool    interrupted :1;
+  bool    reserved2   :1;
+  bool    reserved1   :1;
+  bool    reserved0   :1;
+  uint8_t count       :4;
+} tap_t;
+
+typedef struct {
+  keyevent_t event;
+  tap_t tap;
+} keyrecord_t;
+
+typedef uint16_t action_t;
+
+void process_record(keyrecord_t *record);
+
+/* timer.h */
+#define TIMER_DIFF(a, b, max)   ((a) >= (b) ?  (a) - (b) : (max) - (b) + (a))
+#define TIMER_DIFF_16(a, b)     TIMER_DIFF(a, b, UINT16_MAX)
+#define TIMER_DIFF_32(a, b)     TIMER_DIFF(a, b, UINT32_MAX)
+
+uint16_t timer_read(void);
+uint32_t timer_read32(void);
+uint16_t timer_elapsed(uint16_t last);
+uint32_t timer_elapsed32(uint32_t last);
+
+/* matrix.h */
+#if (MATRIX_COLS <= 8)
+typedef uint8_t  matrix_row_t;
+#elif (MATRIX_COLS <= 16)
+typedef uint16_t matrix_row_t;
+#else
+typedef uint32_t matrix_row_t;
+#endif
+
+void matrix_init(void);
+uint8_t matrix_scan(void);
+bool matrix_is_modified(void);
+bool matrix_is_on(uint8_t row, uint8_t col);
+matrix_row_t matrix_get_row(uint8_t row);
+uint8_t matrix_rows(void);
+uint8_t matrix_cols(void);
+void matrix_print(void);
+uint8_t matrix_key_count(void);
+void matrix_init_quantum(void);
+void matrix_scan_quantum(void);
+void matrix_init_kb(void);
+void matrix_scan_kb(void);
+void matrix_init_user(void);
+void matrix_scan_user(void);
+
+/* util.h */
+uint8_t bitpop16(uint16_t bits);
+uint8_t biton32(uint32_t bits);
+
+/* print.h */
+void print(const char *s);
+void phex(uint8_t c);
+void print_bin_reverse16(uint16_t bits);
+
+/* keycode.h, HID usage IDs and the tmk codes above them */
+enum hid_keyboard_keypad_usage {
+  KC_NO = 0x00,
+  KC_ROLL_OVER,
+  KC_POST_FAIL,
+  KC_UNDEFINED,
+  KC_A,
+  KC_B,
+  KC_C,
+  KC_D,
+  KC_E,
+  KC_F,
+  KC_G,
+  KC_H,
+  KC_I,
+  KC_J,
+  KC_K,
+  KC_L,
+  KC_M,
+  KC_N,
+  KC_O,
+  KC_P,
+  KC_Q,
+  KC_R,
+  KC_S,
+  KC_T,
+  KC_U,
+  KC_V,
+  KC_W,
+  KC_X,
+  KC_Y,
+  KC_Z,
+  KC_1,
+  KC_2,
+  KC_3,
+  KC_4,
+  KC_5,
+  KC_6,
+  KC_7,
+  KC_8,
+  KC_9,
+  KC_0,
+  KC_ENTER,
+  KC_ESCAPE,
+  KC_BSPACE,
+  KC_TAB,
+  KC_SPACE,
+  KC_MINUS,
+  KC_EQUAL,
+  KC_LBRACKET,
+  KC_RBRACKET,
+  KC_BSLASH,
+  KC_NONUS_HASH,
+  KC_SCOLON,
+  KC_QUOTE,
+  KC_GRAVE,
+  KC_COMMA,
+  KC_DOT,
+  KC_SLASH,
+  KC_CAPSLOCK,
+  KC_F1,
+  KC_F2,
+  KC_F3,
+  KC_F4,
+  KC_F5,
+  KC_F6,
+  KC_F7,
+  KC_F8,
+  KC_F9,
+  KC_F10,
+  KC_F11,
+  KC_F12,
+  KC_PSCREEN,
+  KC_SCROLLLOCK,
+  KC_PAUSE,
+  KC_INSERT,
+  KC_HOME,
+  KC_PGUP,
+  KC_DELETE,
+  KC_END,
+  KC_PGDOWN,
+  KC_RIGHT,
+  KC_LEFT,
+  KC_DOWN,
+  KC_UP,
+  KC_NUMLOCK,
+  KC_KP_SLASH,
+  KC_KP_ASTERISK,
+  KC_KP_MINUS,
+  KC_KP_PLUS,
+  KC_KP_ENTER,
+  KC_KP_1,
+  KC_KP_2,
+  KC_KP_3,
+  KC_KP_4,
+  KC_KP_5,
+  KC_KP_6,
+  KC_KP_7,
+  KC_KP_8,
+  KC_KP_9,
+  KC_KP_0,
+  KC_KP_DOT,
+  KC_NONUS_BSLASH,
+  KC_APPLICATION,
+  KC_POWER,
+  KC_KP_EQUAL,
+  KC_F13,
+  KC_F14,
+  KC_F15,
+  KC_F16,
+  KC_F17,
+  KC_F18,
+  KC_F19,
+  KC_F20,
+  KC_F21,
+  KC_F22,
+  KC_F23,
+  KC_F24,
+  KC_EXECUTE,
+  KC_HELP,
+  KC_MENU,
+  KC_SELECT,
+  KC_STOP,
+  KC_AGAIN,
+  KC_UNDO,
+  KC_CUT,
+  KC_COPY,
+  KC_PASTE,
+  KC_FIND,
+  KC__MUTE,
+  KC__VOLUP,
+  KC__VOLDOWN,
+  KC_LOCKING_CAPS,
+  KC_LOCKING_NUM,
+  KC_LOCKING_SCROLL,
+  KC_KP_COMMA,
+  KC_KP_EQUAL_AS400,
+  KC_INT1,
+  KC_INT2,
+  KC_INT3,
+  KC_INT4,
+  KC_INT5,
+  KC_INT6,
+  KC_INT7,
+  KC_INT8,
+  KC_INT9,
+
+  KC_LCTRL = 0xE0,
+  KC_LSHIFT,
+  KC_LALT,
+  KC_LGUI,
+  KC_RCTRL,
+  KC_RSHIFT,
+  KC_RALT,
+  KC_RGUI,
+};
+
+enum internal_special_keycodes {
+  KC_FN0 = 0xC0,
+
+  /* System Control */
+  KC_SYSTEM_POWER = 0xA5,
+  KC_SYSTEM_SLEEP,
+  KC_SYSTEM_WAKE,
+
+  /* Media Control */
+  KC_AUDIO_MUTE,
+  KC_AUDIO_VOL_UP,
+  KC_AUDIO_VOL_DOWN,
+  KC_MEDIA_NEXT_TRACK,
+  KC_MEDIA_PREV_TRACK,
+  KC_MEDIA_STOP,
+  KC_MEDIA_PLAY_PAUSE,
+  KC_MEDIA_SELECT,
+  KC_MEDIA_EJECT,
+  KC_MAIL,
+  KC_CALCULATOR,
+  KC_MY_COMPUTER,
+  KC_WWW_SEARCH,
+  KC_WWW_HOME,
+  KC_WWW_BACK,
+  KC_WWW_FORWARD,
+  KC_WWW_STOP,
+  KC_WWW_REFRESH,
+  KC_WWW_FAVORITES,
+  KC_MEDIA_FAST_FORWARD,
+  KC_MEDIA_REWIND,
+};
+
+enum mouse_keys {
+  KC_MS_UP = 0xF0,
+  KC_MS_DOWN,
+  KC_MS_LEFT,
+  KC_MS_RIGHT,
+  KC_MS_BTN1,
+  KC_MS_BTN2,
+  KC_MS_BTN3,
+  KC_MS_BTN4,
+  KC_MS_BTN5,
+  KC_MS_WH_UP,
+  KC_MS_WH_DOWN,
+  KC_MS_WH_LEFT,
+  KC_MS_WH_RIGHT,
+  KC_MS_ACCEL0,
+  KC_MS_ACCEL1,
+  KC_MS_ACCEL2,
+};
+
+#define KC_TRANSPARENT          0x01
+#define KC_TRNS                 KC_TRANSPARENT
+
+#define KC_LCTL KC_LCTRL
+#define KC_RCTL KC_RCTRL
+#define KC_LSFT KC_LSHIFT
+#define KC_RSFT KC_RSHIFT
+#define KC_ESC  KC_ESCAPE
+#define KC_BSPC KC_BSPACE
+#define KC_ENT  KC_ENTER
+#define KC_DEL  KC_DELETE
+#define KC_INS  KC_INSERT
+#define KC_CAPS KC_CAPSLOCK
+#define KC_RGHT KC_RIGHT
+#define KC_PGDN KC_PGDOWN
+#define KC_SPC  KC_SPACE
+#define KC_MINS KC_MINUS
+#define KC_EQL  KC_EQUAL
+#define KC_LBRC KC_LBRACKET
+#define KC_RBRC KC_RBRACKET
+#define KC_BSLS KC_BSLASH
+#define KC_NUHS KC_NONUS_HASH
+#define KC_NUBS KC_NONUS_BSLASH
+#define KC_SCLN KC_SCOLON
+#define KC_QUOT KC_QUOTE
+#define KC_GRV  KC_GRAVE
+#define KC_COMM KC_COMMA
+#define KC_SLSH KC_SLASH
+#define KC_APP  KC_APPLICATION
+#define KC_PAST KC_PASTE
+
+#define KC_PWR  KC_SYSTEM_POWER
+#define KC_SLEP KC_SYSTEM_SLEEP
+#define KC_WAKE KC_SYSTEM_WAKE
+#define KC_MUTE KC_AUDIO_MUTE
+#define KC_VOLU KC_AUDIO_VOL_UP
+#define KC_VOLD KC_AUDIO_VOL_DOWN
+#define KC_MNXT KC_MEDIA_NEXT_TRACK
+#define KC_MPRV KC_MEDIA_PREV_TRACK
+#define KC_MSTP KC_MEDIA_STOP
+#define KC_MPLY KC_MEDIA_PLAY_PAUSE
+#define KC_MFFD KC_MEDIA_FAST_FORWARD
+#define KC_MRWD KC_MEDIA_REWIND
+#define KC_CALC KC_CALCULATOR
+#define KC_MYCM KC_MY_COMPUTER
+#define KC_WSCH KC_WWW_SEARCH
+#define KC_WHOM KC_WWW_HOME
+#define KC_WBAK KC_WWW_BACK
+#define KC_WFWD KC_WWW_FORWARD
+#define KC_WSTP KC_WWW_STOP
+#define KC_WREF KC_WWW_REFRESH
+#define KC_WFAV KC_WWW_FAVORITES
+
+#define KC_MS_U KC_MS_UP
+#define KC_MS_D KC_MS_DOWN
+#define KC_MS_L KC_MS_LEFT
+#define KC_MS_R KC_MS_RIGHT
+#define KC_BTN1 KC_MS_BTN1
+#define KC_BTN2 KC_MS_BTN2
+#define KC_BTN3 KC_MS_BTN3
+#define KC_BTN4 KC_MS_BTN4
+#define KC_BTN5 KC_MS_BTN5
+#define KC_WH_U KC_MS_WH_UP
+#define KC_WH_D KC_MS_WH_DOWN
+#define KC_WH_L KC_MS_WH_LEFT
+#define KC_WH_R KC_MS_WH_RIGHT
+#define KC_ACL0 KC_MS_ACCEL0
+#define KC_ACL1 KC_MS_ACCEL1
+#define KC_ACL2 KC_MS_ACCEL2
+
+#define IS_KEY(code)            (KC_A <= (code) && (code) <= KC_EXSEL)
+#define KC_EXSEL                0xA4
+#define IS_MOD(code)            (KC_LCTRL <= (code) && (code) <= KC_RGUI)
+#define IS_SYSTEM(code)         (KC_PWR <= (code) && (code) <= KC_WAKE)
+#define IS_CONSUMER(code)       (KC_MUTE <= (code) && (code) <= KC_MRWD)
+#define IS_FN(code)             (KC_FN0 <= (code) && (code) <= 0xDF)
+#define IS_MOUSEKEY(code)       (KC_MS_UP <= (code) && (code) <= KC_MS_ACCEL2)
+#define IS_MOUSEKEY_MOVE(code)  (KC_MS_UP <= (code) && (code) <= KC_MS_RIGHT)
+#define IS_MOUSEKEY_BUTTON(code) (KC_MS_BTN1 <= (code) && (code) <= KC_MS_BTN5)
+#define IS_MOUSEKEY_WHEEL(code) (KC_MS_WH_UP <= (code) && (code) <= KC_MS_WH_RIGHT)
+#define IS_MOUSEKEY_ACCEL(code) (KC_MS_ACCEL0 <= (code) && (code) <= KC_MS_ACCEL2)
+
+#define MOD_BIT(code)           (1 << ((code) & 0x07))
+
+/* keymap.h, quantum keycodes */
+enum quantum_keycodes {
+  QK_TMK                = 0x0000,
+  QK_MODS               = 0x0100,
+  QK_LCTL               = 0x0100,
+  QK_LSFT               = 0x0200,
+  QK_LALT               = 0x0400,
+  QK_LGUI               = 0x0800,
+  QK_RCTL               = 0x1100,
+  QK_RSFT               = 0x1200,
+  QK_RALT               = 0x1400,
+  QK_RGUI               = 0x1800,
+  QK_MODS_MAX           = 0x1FFF,
+  QK_FUNCTION           = 0x2000,
+  QK_FUNCTION_MAX       = 0x2FFF,
+  QK_MOMENTARY          = 0x5100,
+  QK_MOMENTARY_MAX      = 0x51FF,
+  QK_TOGGLE_LAYER       = 0x5300,
+  QK_TOGGLE_LAYER_MAX   = 0x53FF,
+  QK_TAP_DANCE          = 0x5700,
+  QK_TAP_DANCE_MAX      = 0x57FF,
+
+  RESET                 = 0x5C00,
+  MAGIC_SWAP_ALT_GUI,
+  MAGIC_UNSWAP_ALT_GUI,
+  BL_ON,
+  BL_OFF,
+  BL_DEC,
+  BL_INC,
+  BL_TOGG,
+  BL_STEP,
+
+  SAFE_RANGE            = 0x5C40,
+};
+
+#define LCTL(kc)                ((kc) | QK_LCTL)
+#define LSFT(kc)                ((kc) | QK_LSFT)
+#define LALT(kc)                ((kc) | QK_LALT)
+#define LGUI(kc)                ((kc) | QK_LGUI)
+#define RCTL(kc)                ((kc) | QK_RCTL)
+#define RSFT(kc)                ((kc) | QK_RSFT)
+#define RALT(kc)                ((kc) | QK_RALT)
+#define RGUI(kc)                ((kc) | QK_RGUI)
+
+#define KC_EXLM                 LSFT(KC_1)
+#define KC_AT                   LSFT(KC_2)
+#define KC_HASH                 LSFT(KC_3)
+#define KC_DLR                  LSFT(KC_4)
+#define KC_PERC                 LSFT(KC_5)
+#define KC_CIRC                 LSFT(KC_6)
+#define KC_AMPR                 LSFT(KC_7)
+#define KC_ASTR                 LSFT(KC_8)
+#define KC_LPRN                 LSFT(KC_9)
+#define KC_RPRN                 LSFT(KC_0)
+#define KC_PLUS                 LSFT(KC_EQL)
+
+#define AG_SWAP                 MAGIC_SWAP_ALT_GUI
+#define AG_NORM                 MAGIC_UNSWAP_ALT_GUI
+
+#define F(kc)                   (kc | QK_FUNCTION)
+#define MO(layer)               (layer | QK_MOMENTARY)
+#define TG(layer)               (layer | QK_TOGGLE_LAYER)
+#define TD(n)                   (QK_TAP_DANCE + n)
+
+/* action_code.h, only what fn_actions[] here uses */
+#define ACTION_LAYER_TAP_TOGGLE(layer) ((action_t)(0xA000 | ((layer) << 8) | 0xF0))
+
+extern const uint16_t fn_actions[];
+
+/* action_layer.h */
+extern uint32_t default_layer_state;
+extern uint32_t layer_state;
+
+void default_layer_set(uint32_t state);
+void layer_on(uint8_t layer);
+void layer_off(uint8_t layer);
+void layer_invert(uint8_t layer);
+void layer_clear(void);
+
+/* keymap.h */
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key);
+
+/* action.h, action_util.h */
+void register_code(uint8_t code);
+void unregister_code(uint8_t code);
+void register_mods(uint8_t mods);
+void unregister_mods(uint8_t mods);
+void clear_keyboard(void);
+
+uint8_t get_mods(void);
+void add_mods(uint8_t mods);
+void del_mods(uint8_t mods);
+void set_mods(uint8_t mods);
+void add_key(uint8_t key);
+void del_key(uint8_t key);
+void send_keyboard_report(void);
+
+/* keymap.h */
+typedef union {
+  uint8_t raw;
+  struct {
+    bool swap_control_capslock:1;
+    bool capslock_to_control:1;
+    bool swap_lalt_lgui:1;
+    bool swap_ralt_rgui:1;
+    bool no_gui:1;
+    bool swap_grave_esc:1;
+    bool swap_backslash_backspace:1;
+    bool nkro:1;
+  };
+} keymap_config_t;
+
+/* process_tap_dance.h */
+typedef struct {
+  uint8_t count;
+  uint16_t keycode;
+  uint16_t timer;
+  bool interrupted;
+  bool pressed;
+  bool finished;
+} qk_tap_dance_state_t;
+
+typedef void (*qk_tap_dance_user_fn_t)(qk_tap_dance_state_t *state, void *user_data);
+
+typedef struct {
+  struct {
+    qk_tap_dance_user_fn_t on_each_tap;
+    qk_tap_dance_user_fn_t on_dance_finished;
+    qk_tap_dance_user_fn_t on_reset;
+  } fn;
+  qk_tap_dance_state_t state;
+  void *user_data;
+} qk_tap_dance_action_t;
+
+#define ACTION_TAP_DANCE_FN_ADVANCED(user_fn_on_each_tap, user_fn_on_dance_finished, user_fn_on_dance_reset) { \
+    .fn = { user_fn_on_each_tap, user_fn_on_dance_finished, user_fn_on_dance_reset } }
+
+extern qk_tap_dance_action_t tap_dance_actions[];
+
+/* eeconfig.h */
+#define EECONFIG_MAGIC_NUMBER           (uint16_t)0xFEED
+
+#define EECONFIG_MAGIC                  (uint16_t *)0
+#define EECONFIG_DEBUG                  (uint8_t *)2
+#define EECONFIG_DEFAULT_LAYER          (uint8_t *)3
+#define EECONFIG_KEYMAP                 (uint8_t *)4
+#define EECONFIG_MOUSEKEY_ACCEL         (uint8_t *)5
+#define EECONFIG_BACKLIGHT              (uint8_t *)6
+
+bool eeconfig_is_enabled(void);
+void eeconfig_init(void);
+uint8_t eeconfig_read_default_layer(void);
+void eeconfig_update_default_layer(uint8_t val);
+uint8_t eeconfig_read_keymap(void);
+void eeconfig_update_keymap(uint8_t val);
+uint8_t eeconfig_read_backlight(void);
+void eeconfig_update_backlight(uint8_t val);
+
+/* suspend.h */
+void suspend_power_down(void);
+void suspend_wakeup_init(void);
+void suspend_power_down_user(void);
+void suspend_wakeup_init_user(void);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdint.h>
+
+/* LUFA sizes: the NKRO endpoint is 32 bytes, boot reports use the first 8 */
+#define NKRO_EPSIZE             32
+#define KEYBOARD_REPORT_SIZE    NKRO_EPSIZE
+#define KEYBOARD_REPORT_KEYS    (NKRO_EPSIZE - 2)
+#define KEYBOARD_REPORT_BITS    (NKRO_EPSIZE - 1)
+
+typedef union {
+  uint8_t raw[KEYBOARD_REPORT_SIZE];
+  struct {
+    uint8_t mods;
+    uint8_t reserved;
+    uint8_t keys[KEYBOARD_REPORT_KEYS];
+  };
+#ifdef NKRO_ENABLE
+  struct {
+    uint8_t mods;
+    uint8_t bits[KEYBOARD_REPORT_BITS];
+  } nkro;
+#endif
+} __attribute__ ((packed)) report_keyboard_t;
+
+typedef struct {
+  uint8_t buttons;
+  int8_t x;
+  int8_t y;
+  int8_t v;
+  int8_t h;
+} __attribute__ ((packed)) report_mouse_t;
+
+#endif
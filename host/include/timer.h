@@ -0,0 +1,6 @@
+#ifndef HOST_TIMER_H
+#define HOST_TIMER_H
+
+#include "quantum.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_UTIL_H
+#define HOST_UTIL_H
+
+#include "quantum.h"
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_UTIL_ATOMIC_H
+#define HOST_UTIL_ATOMIC_H
+
+/* Interrupts never preempt the main loop here, so a block is just a block */
+#define ATOMIC_RESTORESTATE     0
+#define ATOMIC_FORCEON          1
+#define ATOMIC_BLOCK(type)      for (int atomic_once = 1; atomic_once; atomic_once = 0)
+
+#endif
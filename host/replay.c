@@ -0,0 +1,856 @@
+/*
+ * Host replay of recorded key streams through the keymap
+ *
+ *   ./replay [-l loop_us] [-p] [-E] [-t typed.txt] [-e expected.txt] < stream.txt
+ *
+ * Each input line is one of
+ *
+ *   <ms> <row> <col> <0|1>     the key's contact opens (0) or closes (1)
+ *   <ms> suspend               the host suspends the bus
+ *   <ms> wakeup                and resumes it
+ *   <ms> end                   keeps running until then
+ *   eeprom <addr> <value>      EEPROM contents at power up, before any event
+ *
+ * with '#' starting a comment. Times may have a fraction, so contact bounce can
+ * be written down to the microsecond. trace_decode.py --replay output is read
+ * as is. The stream drives the column pins matrix_ring.c reads; timer 3 fires
+ * every (OCR3A + 1) * 4 us as on the board, and the main loop runs
+ * keyboard_task() every loop_us (100 by default). The scan mode's sleep skips
+ * ahead to the next interrupt.
+ *
+ * Everything the keymap sends the host is printed with its time in ms, the
+ * keyboard report as "report <mods> <crc>" the way trace_decode.py prints a
+ * REPORT record, then the keys down. Layer changes are printed as the trace
+ * records them. -p adds the backlight duty, and -E lists the EEPROM bytes that
+ * differ from power up at the end. -t writes what the keyboard typed, letters,
+ * digits, spaces, Enters, Tabs and '-', to a file, which is how a TRACE key
+ * dump is read back for trace_decode.py. Shift makes letters capital, and any
+ * other modifier turns the character into '^'. -e compares what was
+ * typed with the text the stream was meant to type and counts the characters
+ * to change, add or drop to get there as misfires. A summary follows: the
+ * average, median and largest latency from the first contact of each keystroke
+ * to the first report its key added to, the same for the TH() keys of the
+ * default layer on their own, the timer 3 interrupts run in each scan mode,
+ * the time and EEPROM bytes read and written from power up to the end of the
+ * first scan, and the time spent waiting for the mouse endpoint, which the
+ * host polls every 10 ms, and the layer bits core's layer lookup tests and the
+ * keymap words it reads for each press. The host CPU time spent per key event,
+ * the key events per second that makes, and the time of a layer lookup against
+ * a table flattened from the layer states the stream went through, go to
+ * stderr. They are the gcc build's figures; AVR cycles per event come from the
+ * STATS dump on the board (see stats_decode.py).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "quantum.h"
+#include "host.h"
+#include "matrix_ring.h"
+#include "tap_hold.h"
+#include "action_layer.h"
+#include "util.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <util/crc16.h>
+
+#define MAX_EVENTS      100000
+#define EEPROM_SIZE     1024
+#define EEPROM_WRITE_US 3400
+#define TIMER3_US       4       // clk/64 at 16 MHz
+#define WDT_US          15000   // power down sleeps until the watchdog
+#define MOUSE_POLL_US   10000   // bInterval of lufa's mouse endpoint
+#define LAYER_STATES    256     // distinct layer states layer_summary() tables
+#define LAYER_PASSES    1000
+#define SHIFT_MODS      (MOD_BIT(KC_LSFT) | MOD_BIT(KC_RSFT))
+
+void keyboard_init(void);
+void keyboard_task(void);
+void suspend_power_down(void);
+void suspend_wakeup_init(void);
+uint8_t layer_walk(uint32_t layers, keypos_t key);
+
+extern keymap_config_t keymap_config;
+
+enum event_kinds {
+  EV_KEY,
+  EV_SUSPEND,
+  EV_WAKEUP,
+  EV_END,
+};
+
+typedef struct {
+  uint64_t us;
+  uint8_t kind;
+  uint8_t row;
+  uint8_t col;
+  bool pressed;
+} event_t;
+
+typedef struct {
+  uint32_t layers;
+  keypos_t key;
+} lookup_t;
+
+static event_t events[MAX_EVENTS];
+static uint32_t event_count;
+static uint32_t next_event;
+
+/* Board */
+volatile uint8_t io_space[0x40];
+volatile uint8_t SREG;
+volatile uint8_t MCUCR;
+volatile uint8_t TCNT0;
+volatile uint8_t TCCR1A;
+volatile uint16_t OCR1C;
+volatile uint8_t TCCR3A;
+volatile uint8_t TCCR3B;
+volatile uint16_t TCNT3;
+volatile uint16_t OCR3A;
+volatile uint8_t TIMSK3;
+volatile uint8_t TIFR3;
+unsigned char sleep_mode_set;
+
+static const uint8_t row_pins[MATRIX_ROWS] = MATRIX_ROW_PINS;
+static const uint8_t col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
+
+static uint64_t now_us;
+static uint64_t next_tick_us;
+static bool keys[MATRIX_ROWS][MATRIX_COLS];
+static bool suspended;
+
+static uint8_t eeprom[EEPROM_SIZE];
+static uint8_t eeprom_at_power_up[EEPROM_SIZE];
+static bool show_eeprom;
+static uint64_t eeprom_busy_until;
+static uint32_t eeprom_reads;
+static uint32_t eeprom_writes;
+
+static bool show_pwm;
+static FILE *typed;
+static char *expected;
+static char *typed_text;
+static uint32_t typed_len;
+static uint8_t typed_down[32];          // keycodes down in the last report
+static uint16_t last_duty = 0xFFFF;
+static uint32_t last_layers;
+static uint32_t last_default;
+
+/* Summary */
+static uint32_t ticks[MATRIX_MODES];
+static uint32_t loops;
+static uint32_t wakeups;
+static uint32_t reports;
+/* Power up to the end of the first scan, which applies the settings record */
+static uint64_t boot_us;
+static uint32_t boot_reads;
+static uint32_t boot_writes;
+static uint32_t mouse_reports;
+static uint64_t mouse_wait_us;
+static uint64_t mouse_read_us;          // the host polls the report in the bank
+/* A keystroke starts on a contact closing after DEBOUNCING_DELAY open, and
+ * is paired with the first report its key adds to */
+static uint64_t opened_us[MATRIX_ROWS][MATRIX_COLS];
+static uint64_t stroke_us[MATRIX_ROWS][MATRIX_COLS];
+static bool stroke_pending[MATRIX_ROWS][MATRIX_COLS];
+static bool stroke_added[MATRIX_ROWS][MATRIX_COLS];
+static bool stroke_dual[MATRIX_ROWS][MATRIX_COLS];   // a TH() key on the default layer
+static uint32_t strokes;
+static uint64_t latency_total;
+static uint64_t latency_max;
+static uint32_t latency_count;
+static uint32_t latencies[MAX_EVENTS];
+static uint32_t dual_latencies[MAX_EVENTS];
+static uint32_t dual_count;
+static uint64_t dual_max;
+static uint64_t record_ns;
+static uint32_t records;
+/* Every layer lookup of a press, walked again at the end */
+static lookup_t lookups[MAX_EVENTS];
+static uint32_t lookup_count;
+
+/* timer.c, timer 0 counts ms */
+
+uint16_t timer_read(void) {
+  return now_us / 1000;
+}
+
+uint32_t timer_read32(void) {
+  return now_us / 1000;
+}
+
+uint16_t timer_elapsed(uint16_t last) {
+  return TIMER_DIFF_16(timer_read(), last);
+}
+
+uint32_t timer_elapsed32(uint32_t last) {
+  return TIMER_DIFF_32(timer_read32(), last);
+}
+
+/* EEPROM, a write keeps it busy for EEPROM_WRITE_US */
+
+static void advance(uint64_t until);
+
+// Interrupts keep running while the CPU waits
+static void eeprom_wait(void) {
+  if (now_us < eeprom_busy_until) {
+    advance(eeprom_busy_until);
+  }
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr) {
+  eeprom_wait();
+  eeprom_reads++;
+  return eeprom[(uintptr_t)addr % EEPROM_SIZE];
+}
+
+uint16_t eeprom_read_word(const uint16_t *addr) {
+  const uint8_t *p = (const uint8_t *)addr;
+
+  return eeprom_read_byte(p) | eeprom_read_byte(p + 1) << 8;
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    ((uint8_t *)dst)[i] = eeprom_read_byte((const uint8_t *)src + i);
+  }
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value) {
+  eeprom_wait();
+  eeprom_writes++;
+  eeprom[(uintptr_t)addr % EEPROM_SIZE] = value;
+  eeprom_busy_until = now_us + EEPROM_WRITE_US;
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value) {
+  if (eeprom_read_byte(addr) != value) {
+    eeprom_write_byte(addr, value);
+  }
+}
+
+void eeprom_update_word(uint16_t *addr, uint16_t value) {
+  eeprom_update_byte((uint8_t *)addr, value);
+  eeprom_update_byte((uint8_t *)addr + 1, value >> 8);
+}
+
+bool eeprom_is_ready(void) {
+  return now_us >= eeprom_busy_until;
+}
+
+/* Pins: a column reads low when a closed key joins it to a row driven low */
+
+static void drive_cols(void) {
+  for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+    uint8_t pin = col_pins[c];
+    bool low = false;
+
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+      uint8_t row = row_pins[r];
+      bool driven = (io_space[(row >> 4) + 1] & _BV(row & 0xF)) &&
+                    !(io_space[(row >> 4) + 2] & _BV(row & 0xF));
+
+      low |= driven && keys[r][c];
+    }
+    if (low) {
+      io_space[pin >> 4] &= ~_BV(pin & 0xF);
+    } else {
+      io_space[pin >> 4] |= _BV(pin & 0xF);
+    }
+  }
+}
+
+static void print_time(void) {
+  printf("%llu.%03llu ", (unsigned long long)(now_us / 1000), (unsigned long long)(now_us % 1000));
+}
+
+static void show_duty(void) {
+  uint16_t duty = TCCR1A & _BV(COM1C1) ? OCR1C : 0;
+
+  if (show_pwm && duty != last_duty) {
+    print_time();
+    printf("pwm %u\n", duty);
+  }
+  last_duty = duty;
+}
+
+/* Applies the input up to now */
+static void apply_events(void) {
+  while (next_event < event_count && events[next_event].us <= now_us &&
+         events[next_event].kind == EV_KEY) {
+    event_t *e = &events[next_event++];
+
+    if (e->pressed == keys[e->row][e->col]) {
+      continue;
+    }
+    keys[e->row][e->col] = e->pressed;
+    if (!e->pressed) {
+      opened_us[e->row][e->col] = e->us;
+    } else if (e->us >= opened_us[e->row][e->col] + DEBOUNCING_DELAY * 1000 ||
+               !opened_us[e->row][e->col]) {
+      stroke_us[e->row][e->col] = e->us;
+      stroke_pending[e->row][e->col] = true;
+      stroke_added[e->row][e->col] = false;
+      stroke_dual[e->row][e->col] = IS_TAP_HOLD(keymap_key_to_keycode(biton32(default_layer_state),
+                                                                      (keypos_t){ .row = e->row, .col = e->col }));
+      strokes++;
+    }
+  }
+}
+
+// Called by core.c when the record of key adds a key or modifier
+void replay_key_added(keypos_t key) {
+  stroke_added[key.row][key.col] = true;
+}
+
+// Called by core.c for the layer lookup of every press
+void replay_layer_lookup(uint32_t layers, keypos_t key) {
+  if (lookup_count < MAX_EVENTS) {
+    lookups[lookup_count].layers = layers;
+    lookups[lookup_count].key = key;
+    lookup_count++;
+  }
+}
+
+static uint64_t tick_period(void) {
+  return (uint64_t)(OCR3A + 1) * TIMER3_US;
+}
+
+static void run_tick(void) {
+  now_us = next_tick_us;
+  TCNT0 = now_us % 1000 / 4;
+  apply_events();
+  drive_cols();
+  ticks[matrix_mode()]++;
+  TCNT3 = 0;
+  TIMER3_COMPA_vect();
+  next_tick_us += tick_period();
+  show_duty();
+}
+
+// Runs the interrupts due before until, then moves the clock there
+static void advance(uint64_t until) {
+  while (next_tick_us <= until) {
+    run_tick();
+  }
+  now_us = until;
+  TCNT0 = now_us % 1000 / 4;
+  apply_events();
+}
+
+// Timer 3 or the 1 ms timer 0 overflow, whichever comes first, wakes the CPU
+// from idle; power down only wakes on the watchdog, with timer 3 stopped
+void sleep_cpu(void) {
+  uint64_t ms = (now_us / 1000 + 1) * 1000;
+
+  wakeups++;
+  if (sleep_mode_set == SLEEP_MODE_PWR_DOWN) {
+    show_duty();
+    now_us += WDT_US;
+    next_tick_us = now_us + tick_period();
+    apply_events();
+    return;
+  }
+  advance(next_tick_us < ms ? next_tick_us : ms);
+}
+
+/* Host side of the USB link */
+
+static bool nkro(void) {
+#ifdef NKRO_ENABLE
+  return keyboard_protocol && keymap_config.nkro;
+#else
+  return false;
+#endif
+}
+
+// The bitmap of an NKRO report; nothing is read from it without NKRO_ENABLE
+static const uint8_t *nkro_bits(report_keyboard_t *report) {
+#ifdef NKRO_ENABLE
+  return report->nkro.bits;
+#else
+  return report->keys;
+#endif
+}
+
+static char typed_char(uint8_t code) {
+  if (code >= KC_A && code <= KC_Z) {
+    return 'a' + code - KC_A;
+  }
+  if (code >= KC_1 && code <= KC_9) {
+    return '1' + code - KC_1;
+  }
+  switch (code) {
+    case KC_0:
+      return '0';
+    case KC_SPC:
+      return ' ';
+    case KC_ENT:
+      return '\n';
+    case KC_TAB:
+      return '\t';
+    case KC_MINS:
+      return '-';
+  }
+  return 0;
+}
+
+static void type_char(char c) {
+  if (typed) {
+    fputc(c, typed);
+  }
+  if (expected) {
+    typed_text = realloc(typed_text, typed_len + 1);
+    typed_text[typed_len++] = c;
+  }
+}
+
+// The characters of the keys the report adds, as a text editor would get them
+static void type_report(report_keyboard_t *report) {
+  uint8_t down[32] = { 0 };
+
+  for (uint16_t code = 0; code < 256; code++) {
+    bool on = false;
+
+    if (nkro()) {
+      on = code < KEYBOARD_REPORT_BITS * 8 && nkro_bits(report)[code >> 3] & (1 << (code & 7));
+    } else {
+      for (uint8_t i = 0; i < 6; i++) {
+        on = on || (code && report->keys[i] == code);
+      }
+    }
+    if (!on) {
+      continue;
+    }
+    down[code >> 3] |= 1 << (code & 7);
+    if (!(typed_down[code >> 3] & (1 << (code & 7))) && typed_char(code)) {
+      char c = typed_char(code);
+
+      if (report->mods & ~SHIFT_MODS) {
+        c = '^';
+      } else if (report->mods && c >= 'a' && c <= 'z') {
+        c += 'A' - 'a';
+      }
+      type_char(c);
+    }
+  }
+  memcpy(typed_down, down, sizeof(down));
+}
+
+static void send_keyboard(report_keyboard_t *report) {
+  const uint8_t *bytes = nkro() ? nkro_bits(report) : report->keys;
+  uint8_t len = nkro() ? KEYBOARD_REPORT_BITS : 6;
+  uint8_t crc = 0;
+
+  for (uint8_t i = 0; i < len; i++) {
+    crc = _crc8_ccitt_update(crc, bytes[i]);
+  }
+  print_time();
+  printf("report %02x %02x [", report->mods, crc);
+  if (nkro()) {
+    for (uint16_t code = 0; code < KEYBOARD_REPORT_BITS * 8; code++) {
+      if (nkro_bits(report)[code >> 3] & (1 << (code & 7))) {
+        printf(" %02x", code);
+      }
+    }
+  } else {
+    for (uint8_t i = 0; i < 6; i++) {
+      if (report->keys[i]) {
+        printf(" %02x", report->keys[i]);
+      }
+    }
+  }
+  printf(" ]\n");
+  if (typed || expected) {
+    type_report(report);
+  }
+
+  reports++;
+  for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+    for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+      uint64_t latency = now_us - stroke_us[r][c];
+
+      if (!stroke_pending[r][c] || !stroke_added[r][c]) {
+        continue;
+      }
+      stroke_pending[r][c] = false;
+      latencies[latency_count] = latency;
+      latency_total += latency;
+      latency_count++;
+      if (latency > latency_max) {
+        latency_max = latency;
+      }
+      if (stroke_dual[r][c]) {
+        dual_latencies[dual_count++] = latency;
+        if (latency > dual_max) {
+          dual_max = latency;
+        }
+      }
+    }
+  }
+}
+
+// lufa waits for the endpoint bank, which frees up when the host polls the
+// report before; interrupts run meanwhile
+static void send_mouse(report_mouse_t *report) {
+  if (now_us < mouse_read_us) {
+    mouse_wait_us += mouse_read_us - now_us;
+    advance(mouse_read_us);
+  }
+  mouse_read_us = (now_us / MOUSE_POLL_US + 1) * MOUSE_POLL_US;
+  mouse_reports++;
+  print_time();
+  printf("mouse %02x %d %d %d %d\n", report->buttons, report->x, report->y, report->v, report->h);
+}
+
+static void send_system(uint16_t data) {
+  print_time();
+  printf("system %04x\n", data);
+}
+
+static void send_consumer(uint16_t data) {
+  print_time();
+  printf("consumer %04x\n", data);
+}
+
+static host_driver_t driver = {
+  .send_keyboard = send_keyboard,
+  .send_mouse = send_mouse,
+  .send_system = send_system,
+  .send_consumer = send_consumer,
+};
+
+/* process_record() is timed from keyboard_task(), replays from inside it
+ * included */
+
+static void timed_keyboard_task(void) {
+  struct timespec a, b;
+
+  clock_gettime(CLOCK_MONOTONIC, &a);
+  keyboard_task();
+  clock_gettime(CLOCK_MONOTONIC, &b);
+  if (matrix_is_modified()) {
+    record_ns += (b.tv_sec - a.tv_sec) * 1000000000ULL + b.tv_nsec - a.tv_nsec;
+    records++;
+  }
+
+  if (layer_state != last_layers) {
+    last_layers = layer_state;
+    print_time();
+    printf("layer %04x\n", (unsigned)(layer_state & 0xFFFF));
+  }
+  if (default_layer_state != last_default) {
+    last_default = default_layer_state;
+    print_time();
+    printf("default %d\n", biton32(default_layer_state));
+  }
+}
+
+static void read_events(FILE *in) {
+  char line[256];
+
+  memset(eeprom, 0xFF, sizeof(eeprom));
+  while (fgets(line, sizeof(line), in)) {
+    char word[16];
+    double ms;
+    unsigned a, b, c;
+    event_t *e = &events[event_count];
+
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    if (sscanf(line, "eeprom %u %u", &a, &b) == 2) {
+      eeprom[a % EEPROM_SIZE] = b;
+      continue;
+    }
+    if (event_count == MAX_EVENTS) {
+      fprintf(stderr, "more than %d events\n", MAX_EVENTS);
+      exit(1);
+    }
+    if (sscanf(line, "%lf %u %u %u", &ms, &a, &b, &c) == 4) {
+      if (a >= MATRIX_ROWS || b >= MATRIX_COLS) {
+        fprintf(stderr, "no key at %u %u\n", a, b);
+        exit(1);
+      }
+      *e = (event_t){ .us = ms * 1000 + 0.5, .kind = EV_KEY, .row = a, .col = b, .pressed = c };
+    } else if (sscanf(line, "%lf %15s", &ms, word) == 2) {
+      e->us = ms * 1000 + 0.5;
+      if (!strcmp(word, "suspend")) {
+        e->kind = EV_SUSPEND;
+      } else if (!strcmp(word, "wakeup")) {
+        e->kind = EV_WAKEUP;
+      } else if (!strcmp(word, "end")) {
+        e->kind = EV_END;
+      } else {
+        fprintf(stderr, "cannot read: %s", line);
+        exit(1);
+      }
+    } else {
+      fprintf(stderr, "cannot read: %s", line);
+      exit(1);
+    }
+    if (event_count && e->us < events[event_count - 1].us) {
+      fprintf(stderr, "out of order: %s", line);
+      exit(1);
+    }
+    event_count++;
+  }
+}
+
+static char *read_file(const char *name) {
+  FILE *f = fopen(name, "r");
+  char *text = NULL;
+  size_t len = 0;
+  int c;
+
+  if (!f) {
+    perror(name);
+    exit(1);
+  }
+  while ((c = fgetc(f)) != EOF) {
+    text = realloc(text, len + 2);
+    text[len++] = c;
+  }
+  fclose(f);
+  if (!text) {
+    text = malloc(1);
+  }
+  text[len] = 0;
+  return text;
+}
+
+static int compare_latency(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static double median_ms(uint32_t *latency, uint32_t count) {
+  if (!count) {
+    return 0.0;
+  }
+  qsort(latency, count, sizeof(latency[0]), compare_latency);
+  if (count & 1) {
+    return latency[count / 2] / 1000.0;
+  }
+  return (latency[count / 2 - 1] + latency[count / 2]) / 2000.0;
+}
+
+// Edit distance from what was typed to the expected text
+static uint32_t misfires(void) {
+  uint32_t n = strlen(expected);
+  uint32_t *prev = malloc((n + 1) * sizeof(uint32_t));
+  uint32_t *cur = malloc((n + 1) * sizeof(uint32_t));
+  uint32_t result;
+
+  for (uint32_t j = 0; j <= n; j++) {
+    prev[j] = j;
+  }
+  for (uint32_t i = 1; i <= typed_len; i++) {
+    uint32_t *swap;
+
+    cur[0] = i;
+    for (uint32_t j = 1; j <= n; j++) {
+      uint32_t best = prev[j - 1] + (typed_text[i - 1] != expected[j - 1]);
+
+      if (prev[j] + 1 < best) {
+        best = prev[j] + 1;
+      }
+      if (cur[j - 1] + 1 < best) {
+        best = cur[j - 1] + 1;
+      }
+      cur[j] = best;
+    }
+    swap = prev;
+    prev = cur;
+    cur = swap;
+  }
+  result = prev[n];
+  free(prev);
+  free(cur);
+  return result;
+}
+
+static uint64_t elapsed_ns(struct timespec *a, struct timespec *b) {
+  return (b->tv_sec - a->tv_sec) * 1000000000ULL + b->tv_nsec - a->tv_nsec;
+}
+
+// What core's walk costs per press, counted and timed against a table holding
+// the layer each key resolves to for every layer state seen
+static void layer_summary(void) {
+  static uint32_t states[LAYER_STATES];
+  static uint8_t flat[LAYER_STATES][MATRIX_ROWS][MATRIX_COLS];
+  static uint8_t state_of[MAX_EVENTS];
+  uint32_t nstates = 0;
+  uint64_t tests = 0;
+  uint64_t reads = 0;
+  uint64_t walk_ns;
+  uint64_t flat_ns;
+  volatile uint8_t sink;
+  struct timespec a, b;
+
+  if (!lookup_count) {
+    return;
+  }
+  for (uint32_t i = 0; i < lookup_count; i++) {
+    uint32_t layers = lookups[i].layers;
+    uint8_t found = layer_walk(layers, lookups[i].key);
+    uint32_t s = 0;
+
+    tests += 32 - found;
+    reads += __builtin_popcount(layers >> found);
+    while (s < nstates && states[s] != layers) {
+      s++;
+    }
+    if (s == nstates) {
+      if (nstates == LAYER_STATES) {
+        return;
+      }
+      states[nstates++] = layers;
+      for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+          flat[s][r][c] = layer_walk(layers, (keypos_t){ .row = r, .col = c });
+        }
+      }
+    }
+    state_of[i] = s;
+  }
+  printf("# layer lookups %u, %.1f layer bits tested and %.1f keymap words read each, %u layer states\n",
+         lookup_count, (double)tests / lookup_count, (double)reads / lookup_count, nstates);
+
+  clock_gettime(CLOCK_MONOTONIC, &a);
+  for (uint32_t n = 0; n < LAYER_PASSES; n++) {
+    for (uint32_t i = 0; i < lookup_count; i++) {
+      sink = layer_walk(lookups[i].layers, lookups[i].key);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &b);
+  walk_ns = elapsed_ns(&a, &b);
+  clock_gettime(CLOCK_MONOTONIC, &a);
+  for (uint32_t n = 0; n < LAYER_PASSES; n++) {
+    for (uint32_t i = 0; i < lookup_count; i++) {
+      sink = flat[state_of[i]][lookups[i].key.row][lookups[i].key.col];
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &b);
+  flat_ns = elapsed_ns(&a, &b);
+  (void)sink;
+  fprintf(stderr, "host time per layer lookup %.1f ns walking, %.1f ns from a flattened table\n",
+          (double)walk_ns / LAYER_PASSES / lookup_count, (double)flat_ns / LAYER_PASSES / lookup_count);
+}
+
+// Skips the key events already applied to find the next control event
+static event_t *next_control(void) {
+  for (uint32_t i = next_event; i < event_count; i++) {
+    if (events[i].kind != EV_KEY) {
+      return &events[i];
+    }
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  uint64_t loop_us = 100;
+  uint64_t last_us;
+  event_t *control;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+      loop_us = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-p")) {
+      show_pwm = true;
+    } else if (!strcmp(argv[i], "-E")) {
+      show_eeprom = true;
+    } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+      typed = fopen(argv[++i], "w");
+      if (!typed) {
+        perror(argv[i]);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "-e") && i + 1 < argc) {
+      expected = read_file(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [-l loop_us] [-p] [-E] [-t typed.txt] [-e expected.txt] < stream.txt\n", argv[0]);
+      return 1;
+    }
+  }
+  read_events(stdin);
+  memcpy(eeprom_at_power_up, eeprom, EEPROM_SIZE);
+  last_us = event_count ? events[event_count - 1].us : 0;
+
+  // lufa.c: keyboard_init() first, the driver after it
+  keyboard_init();
+  host_set_driver(&driver);
+  next_tick_us = tick_period();
+
+  for (;;) {
+    control = next_control();
+    if (control && control->us <= now_us) {
+      while (next_event < event_count && &events[next_event] != control) {
+        next_event++;
+      }
+      next_event++;
+      if (control->kind == EV_SUSPEND) {
+        suspended = true;
+      } else if (control->kind == EV_WAKEUP) {
+        suspended = false;
+        suspend_wakeup_init();
+      }
+      continue;
+    }
+    if (next_event >= event_count && now_us >= last_us + 1000000) {
+      break;
+    }
+    if (suspended) {
+      uint64_t start = now_us;
+
+      suspend_power_down();
+      if (now_us == start) {
+        advance(now_us + loop_us);
+      }
+      continue;
+    }
+    advance(now_us + loop_us);
+    timed_keyboard_task();
+    if (!loops) {
+      boot_us = now_us;
+      boot_reads = eeprom_reads;
+      boot_writes = eeprom_writes;
+    }
+    loops++;
+  }
+
+  printf("# keystrokes %u, reports %u, first contact to report %.3f ms average, %.3f ms median, %.3f ms max"
+         " over %u keystrokes\n", strokes, reports, latency_count ? latency_total / 1000.0 / latency_count : 0.0,
+         median_ms(latencies, latency_count), latency_max / 1000.0, latency_count);
+  if (dual_count) {
+    printf("# dual-role keystrokes %u, %.3f ms median, %.3f ms max\n",
+           dual_count, median_ms(dual_latencies, dual_count), dual_max / 1000.0);
+  }
+  printf("# ticks active %u, idle %u, sleep %u; main loop runs %u, sleeps %u\n",
+         ticks[MATRIX_MODE_ACTIVE], ticks[MATRIX_MODE_IDLE], ticks[MATRIX_MODE_SLEEP], loops, wakeups);
+  printf("# boot %.3f ms to the end of the first scan, %u EEPROM bytes read and %u written\n",
+         boot_us / 1000.0, boot_reads, boot_writes);
+  if (mouse_reports) {
+    printf("# mouse reports %u, %.3f ms waiting for the endpoint\n", mouse_reports, mouse_wait_us / 1000.0);
+  }
+  layer_summary();
+  for (uint32_t a = 0; show_eeprom && a < EEPROM_SIZE; a++) {
+    if (eeprom[a] != eeprom_at_power_up[a]) {
+      printf("# eeprom %u %u\n", a, eeprom[a]);
+    }
+  }
+  if (expected) {
+    printf("# typed %u characters, %zu expected, %u misfires\n", typed_len, strlen(expected), misfires());
+  }
+  if (typed) {
+    fclose(typed);
+  }
+  fprintf(stderr, "host time per key event %.0f ns, %.0f events/s\n",
+          records ? (double)record_ns / records : 0.0, record_ns ? records * 1e9 / record_ns : 0.0);
+  return 0;
+}
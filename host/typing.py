@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+#
+# Writes traces/typing.txt, a stream of prose typed on the Dvorak layer, and
+# traces/typing.expected, the text it should type:
+#
+#   ./typing.py
+#
+# Presses come a lognormal interval apart, about 90 words a minute, and are
+# held 50-180 ms, so rolls, where the next key goes down before the last one
+# is up, are common. Paragraphs start with a Tab and end with Enter, and
+# sentences start with Shift held over the first letter. The seed is fixed, so
+# the stream only changes when this script does.
+#
+import random
+
+TEXT = """\
+the keyboard sends a report every time a key goes down or up and the host
+reads it on the next poll of the endpoint. so the time from the finger to the
+screen is the scan and the debounce and whatever the keymap holds back. dual
+role keys hold back the most since a tap and a hold look the same until the
+key goes up or another key goes down. the engine has to guess early without
+guessing wrong in the middle of a word.
+
+a typing streak says that a thumb on the space bar right after a letter is a
+space and not the start of a layer. permissive hold says that a key pressed
+and let go under a held key is meant with it. the two rules pull in opposite
+directions on a fast roll and the trace is here to count who wins.
+
+numbers like 42 and 1024 and words with dashes like left-hand or one-shot
+come through the same path and should come out as typed. so should the tab
+at the start of each paragraph and the enter at its end.
+"""
+
+KEYS = {}
+for row, keys in enumerate(["',.pyfgcrl", "aoeuidhtns", ";qjkxbmwvz"]):
+    for col, ch in enumerate(keys):
+        KEYS[ch] = (row, col + 1)
+KEYS[" "] = (3, 5)                      # SpcNav
+KEYS["-"] = (1, 11)                     # -/Ctl
+KEYS["\t"] = (1, 0)                     # Tab/Ctl
+KEYS["\n"] = (2, 11)                    # En/Sft
+SHIFT = (2, 0)
+
+# Raise puts the digits on the top row, right half first
+RAISE = (3, 7)
+DIGITS = {d: (0, 6 + i) if i < 5 else (1, 1 + i) for i, d in enumerate("1234567890")}
+
+
+# A key pressed again before the last press of it is up lets go just before
+def fix_repeats(events):
+    events = [list(e) for e in sorted(events, key=lambda e: (e[0], e[2]))]
+    last_press = {}
+    last_release = {}
+    for event in events:
+        when, key, pressed = event
+        if not pressed:
+            last_release[key] = event
+            continue
+        release = last_release.get(key)
+        if key in last_press and (release is None or release[0] >= when):
+            for other in events:
+                if other[1] == key and not other[2] and other[0] >= when:
+                    other[0] = max(when - 15, last_press[key] + 20)
+                    break
+        last_press[key] = when
+        last_release[key] = None
+    return sorted(events, key=lambda e: (e[0], e[2]))
+
+
+def main():
+    rng = random.Random(5)
+    events = []
+    expected = []
+    t = 500.0
+
+    def tap(key, hold):
+        events.append((t, key, 1))
+        events.append((t + hold, key, 0))
+
+    sentence_start = True
+    for paragraph in TEXT.split("\n\n"):
+        for ch in "\t" + " ".join(paragraph.split()) + "\n":
+            hold = min(max(rng.gauss(95, 25), 50), 180)
+            gap = min(max(rng.lognormvariate(4.7, 0.35), 35), 600)
+            if ch == ".":
+                sentence_start = True
+                t += gap
+                continue
+            if ch.isdigit():
+                tap(RAISE, 300)
+                t += 60
+                tap(DIGITS[ch], hold)
+                gap = 260
+            elif ch.isalpha() and sentence_start:
+                tap(SHIFT, 40 + hold + 10)
+                t += 40
+                tap(KEYS[ch], hold)
+                ch = ch.upper()
+                gap = hold + 30
+            else:
+                tap(KEYS[ch], hold)
+            if ch.isalpha():
+                sentence_start = False
+            expected.append(ch)
+            t += gap
+        t += 400
+
+    with open("traces/typing.txt", "w") as f:
+        f.write("# Generated by typing.py, see there. Replayed with -e typing.expected, the\n")
+        f.write("# summary counts the characters that came out wrong\n")
+        for when, (row, col), pressed in fix_repeats(events):
+            f.write("%.1f %d %d %d\n" % (when, row, col, pressed))
+    with open("traces/typing.expected", "w") as f:
+        f.write("".join(expected))
+
+
+if __name__ == "__main__":
+    main()
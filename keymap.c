@@ -3,7 +3,19 @@
 #include "planck.h"
 #include "action_layer.h"
 #include "eeconfig.h"
+#include "util.h"
 #include "keymap_br.h"
+#include "tap_hold.h"
+#include "eeprom_cache.h"
+#include "stats.h"
+#include "report_filter.h"
+#include "mouse_motion.h"
+#include "backlight_pwm.h"
+#include "swap_layer.h"
+#include "dead_key.h"
+#include "settings.h"
+#include "trace.h"
+#include "chord.h"
 
 extern keymap_config_t keymap_config;
 
@@ -12,18 +24,48 @@ enum planck_keycodes {
   DVORAK = SAFE_RANGE,
   QWERTY,
   GAME,
-  LOWER,
-  RAISE,
+  STATS,
+  TRACE,
+  SWAP_HANDS,
+  SWAP_HANDS_OFF,
 };
 
 enum tapdace_keycodes {
   TD_ESC_CAPS
 };
 
+enum taphold_keycodes {
+  TH_CTL_TAB,
+  TH_CTL_MNS,
+  TH_CTL_QUT,
+  TH_SFT_ENT,
+  TH_CTL_ENT,
+  TH_TC_SPC,
+};
+
+enum deadkey_keycodes {
+  DK_A_ACUT,
+  DK_A_GRAV,
+  DK_A_CIRC,
+  DK_A_TILD,
+  DK_E_ACUT,
+  DK_E_CIRC,
+  DK_I_ACUT,
+  DK_O_ACUT,
+  DK_O_CIRC,
+  DK_O_TILD,
+  DK_U_ACUT,
+  DK_U_TRMA,
+  DK_C_CEDL,
+};
+
+enum chord_roles {
+  CR_LOWER,
+  CR_RAISE,
+};
+
 enum funcs_keycodes {
   FN_TGGL_NUMPD,
-  FN_SWAP_HANDS,
-  FN_SWAP_HDOFF,
 };
 
 // Each layer gets a name for readability, which is then used in the keymap matrix below.
@@ -33,15 +75,22 @@ enum funcs_keycodes {
 #define _DVORAK       0
 #define _QWERTY       1
 #define _GAMING       2
-#define _ONEHAND      3
-#define _LOWER        5
-#define _RAISE        6
-#define _TOUCHCURSOR  7
-#define _MOUSECURSOR  8
-#define _LFTMCURSOR   9
-#define _NUMPAD       10
-#define _UTIL         11
-#define _NEXUS        12
+// Keep the numbers dense: every index up to the highest one costs a full
+// MATRIX_ROWS * MATRIX_COLS layer of flash in keymaps[], defined or not.
+// The swap layers follow the base layers in the same order, see swap_layer().
+#define _DVORAK_SWAP  3
+#define _QWERTY_SWAP  4
+#define _GAMING_SWAP  5
+#define _ONEHAND      6
+#define _LOWER        7
+#define _RAISE        8
+#define _TOUCHCURSOR  9
+#define _MOUSECURSOR  10
+#define _LFTMCURSOR   11
+#define _NUMPAD       12
+#define _ACCENT       13
+#define _UTIL         14
+#define _NEXUS        15
 
 // Fillers to make layering more clear
 #define _______       KC_TRNS
@@ -57,104 +106,135 @@ enum funcs_keycodes {
 #define TG_NP         TG(_NUMPAD)
 #define TG_OH         TG(_ONEHAND)
 
-// Layer while holding
+// Layer while holding, Nexus with both, see chords[] below
+#define LOWER         CR(CR_LOWER)
+#define RAISE         CR(CR_RAISE)
+
 #define TCURSOR       MO(_TOUCHCURSOR)
 #define MCURSOR       MO(_MOUSECURSOR)
 #define LMCURSR       MO(_LFTMCURSOR)
 #define NUMPAD        MO(_NUMPAD)
 #define UTIL          MO(_UTIL)
+#define ACCENT        MO(_ACCENT)
 
-#define TC_SPC        LT(_TOUCHCURSOR, KC_SPC)
+#define TC_SPC        TH(TH_TC_SPC)          //Tap to space, hold for TouchCursor
 
 /*
  * Key Aliases
  */
 
-// DeadKeys MokeyPatch
-#define LV_QUOT       RALT(KC_QUOT)          //Avoid DeadKey on Quote
-#define LV_CIRC       RALT(KC_CIRC)          //Avoid DeadKey on Circunflex
-
 // Cedilla character on each platform
 #define LN_CEDL       RALT(KC_COMM)          //Linux implementation of Ç
 
 // TapDancing
-#define ESC_CPL       TD(TD_ESC_CAPS)        //Tap once for ESC, twice for Caps Lock
-
-// Tap and Hold keys
-#define SFT_ENT       SFT_T(KC_ENT)          //Tap to ENTER, hold to SHIFT
-
-#define CTL_TAB       CTL_T(KC_TAB)          //Tap to tab, hold to Ctrl
-#define CTL_MNS       CTL_T(KC_MINS)         //Tap to minus, hold to Ctrl
-#define CTL_QUT       CTL_T(KC_QUOT)         //Tap to quote, hold to Ctrl
-#define CTL_ENT       CTL_T(KC_ENT)          //Tap to enter, hold to Ctrl
+#define ESC_CPL       TD(TD_ESC_CAPS)        //Tap once for ESC (sent at once), twice for Caps Lock
+
+// Tap and Hold keys, see tap_hold_keys[] below
+#define SFT_ENT       TH(TH_SFT_ENT)         //Tap to ENTER, hold to SHIFT
+
+#define CTL_TAB       TH(TH_CTL_TAB)         //Tap to tab, hold to Ctrl
+#define CTL_MNS       TH(TH_CTL_MNS)         //Tap to minus, hold to Ctrl
+#define CTL_QUT       TH(TH_CTL_QUT)         //Tap to quote, hold to Ctrl
+#define CTL_ENT       TH(TH_CTL_ENT)         //Tap to enter, hold to Ctrl
+
+// Accented letters, typed as dead key + letter, see dead_key_seqs[] below
+#define PT_AACU       DK(DK_A_ACUT)          //á
+#define PT_AGRV       DK(DK_A_GRAV)          //à
+#define PT_ACIR       DK(DK_A_CIRC)          //â
+#define PT_ATIL       DK(DK_A_TILD)          //ã
+#define PT_EACU       DK(DK_E_ACUT)          //é
+#define PT_ECIR       DK(DK_E_CIRC)          //ê
+#define PT_IACU       DK(DK_I_ACUT)          //í
+#define PT_OACU       DK(DK_O_ACUT)          //ó
+#define PT_OCIR       DK(DK_O_CIRC)          //ô
+#define PT_OTIL       DK(DK_O_TILD)          //õ
+#define PT_UACU       DK(DK_U_ACUT)          //ú
+#define PT_UTRM       DK(DK_U_TRMA)          //ü
+#define PT_CCDL       DK(DK_C_CEDL)          //ç
+
+// Swap hands, see swap_layer.h
+#define SWP_HND       SWAP_HANDS             //Hold to mirror the base layer, tap to toggle
+#define SWP_OFF       SWAP_HANDS_OFF         //Turn mirroring off on release
 
 // Function keys
-#define SWP_HND       F(FN_SWAP_HANDS)
-#define SWP_OFF       F(FN_SWAP_HDOFF)
 #define TPTG_NP       F(FN_TGGL_NUMPD)
 
-const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
-
-  /* Dvorak
-    +========+========+========+========+========+========+========+========+========+========+========+========+
-    | __01__ | __02__ | __03__ | __04__ | __05__ | __06__ | __07__ | __08__ | __09__ | __10__ | __11__ | __12__ |
-    +========+========+========+========+========+========+========+========+========+========+========+========+
-    | Esc.Cl | '      | ,      | .      | P      | Y      | F      | G      | C      | R      | L      | Bksp   |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    | Tb/Ctl | A      | O      | E      | U      | I      | D      | H      | T      | N      | S      | -/Ctl  |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    | Shift  | ;      | Q      | J      | K      | X      | B      | M      | W      | V      | Z      | En/Sh  |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    | Ctrl   | Gui    | Num    | Alt    | Lower  | SpcNav | SpcNav | Raise  | Alt    | Util   | Esc    | En/Ctl |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-   */
-  [_DVORAK] = {
-    { ESC_CPL, BR_QUOT, KC_COMM, KC_DOT , KC_P   , KC_Y   , KC_F   , KC_G   , KC_C   , KC_R   , KC_L   , KC_BSPC},
-    { CTL_TAB, KC_A   , KC_O   , KC_E   , KC_U   , KC_I   , KC_D   , KC_H   , KC_T   , KC_N   , KC_S   , CTL_MNS},
-    { KC_LSFT, BR_SCLN, KC_Q   , KC_J   , KC_K   , KC_X   , KC_B   , KC_M   , KC_W   , KC_V   , KC_Z   , SFT_ENT},
-    { KC_LCTL, KC_LGUI, TPTG_NP, KC_LALT, LOWER  , TC_SPC , TC_SPC , RAISE  , KC_RALT, UTIL   , KC_ESC , CTL_ENT}
-  },
+// Base layers are defined as row lists so that swap_layer.h can expand each
+// one twice: as is, and mirrored for swap hands.
+
+/* Dvorak
+  +========+========+========+========+========+========+========+========+========+========+========+========+
+  | __01__ | __02__ | __03__ | __04__ | __05__ | __06__ | __07__ | __08__ | __09__ | __10__ | __11__ | __12__ |
+  +========+========+========+========+========+========+========+========+========+========+========+========+
+  | Esc.Cl | '      | ,      | .      | P      | Y      | F      | G      | C      | R      | L      | Bksp   |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+  | Tb/Ctl | A      | O      | E      | U      | I      | D      | H      | T      | N      | S      | -/Ctl  |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+  | Shift  | ;      | Q      | J      | K      | X      | B      | M      | W      | V      | Z      | En/Sh  |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+  | Ctrl   | Gui    | Num    | Alt    | Lower  | SpcNav | SpcNav | Raise  | Alt    | Util   | Esc    | En/Ctl |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+ */
+#define DVORAK_ROWS \
+  (ESC_CPL, BR_QUOT, KC_COMM, KC_DOT , KC_P   , KC_Y   , KC_F   , KC_G   , KC_C   , KC_R   , KC_L   , KC_BSPC), \
+  (CTL_TAB, KC_A   , KC_O   , KC_E   , KC_U   , KC_I   , KC_D   , KC_H   , KC_T   , KC_N   , KC_S   , CTL_MNS), \
+  (KC_LSFT, BR_SCLN, KC_Q   , KC_J   , KC_K   , KC_X   , KC_B   , KC_M   , KC_W   , KC_V   , KC_Z   , SFT_ENT), \
+  (KC_LCTL, KC_LGUI, TPTG_NP, KC_LALT, LOWER  , TC_SPC , TC_SPC , RAISE  , KC_RALT, UTIL   , KC_ESC , CTL_ENT)
+
+/* Qwerty
+  +========+========+========+========+========+========+========+========+========+========+========+========+
+  | __01__ | __02__ | __03__ | __04__ | __05__ | __06__ | __07__ | __08__ | __09__ | __10__ | __11__ | __12__ |
+  +========+========+========+========+========+========+========+========+========+========+========+========+
+  | Esc.Cl | Q      | W      | E      | R      | T      | Y      | U      | I      | O      | P      | Bksp   |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+  | Tb/Ctl | A      | S      | D      | F      | G      | H      | J      | K      | L      | ;      | '/Ctl  |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+  | Shift  | Z      | X      | C      | V      | B      | N      | M      | ,      | .      | /      | En/Sh  |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+  | Ctrl   | Gui    | Num    | Alt    | Lower  | SpcNav | SpcNav | Raise  | Alt    | OneHnd | Esc    | En/Ctl |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+ */
+#define QWERTY_ROWS \
+  (ESC_CPL, KC_Q   , KC_W   , KC_E   , KC_R   , KC_T   , KC_Y   , KC_U   , KC_I   , KC_O   , KC_P   , KC_BSPC), \
+  (CTL_TAB, KC_A   , KC_S   , KC_D   , KC_F   , KC_G   , KC_H   , KC_J   , KC_K   , KC_L   , BR_SCLN, CTL_QUT), \
+  (KC_LSFT, KC_Z   , KC_X   , KC_C   , KC_V   , KC_B   , KC_N   , KC_M   , KC_COMM, KC_DOT , BR_SLSH, SFT_ENT), \
+  (KC_LCTL, KC_LGUI, TPTG_NP, KC_LALT, LOWER  , TC_SPC , TC_SPC , RAISE  , KC_RALT, UTIL   , KC_ESC , CTL_ENT)
+
+/* Gaming - plain keys only, nothing waits for a tap or hold decision
+  +========+========+========+========+========+========+========+========+========+========+========+========+
+  | __01__ | __02__ | __03__ | __04__ | __05__ | __06__ | __07__ | __08__ | __09__ | __10__ | __11__ | __12__ |
+  +========+========+========+========+========+========+========+========+========+========+========+========+
+  | Esc    | Q      | W      | E      | R      | T      | Y      | U      | I      | O      | P      | Bksp   |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+  | Tab    | A      | S      | D      | F      | G      | H      | J      | K      | L      | ;      | '      |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+  | Shift  | Z      | X      | C      | V      | B      | N      | M      | ,      | .      | /      | Shift  |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+  | Ctrl   | Gui    | Num    | Alt    | Lower  | Space  | Space  | Raise  | Alt    | Util   | Esc    | Enter  |
+  +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+ */
+#define GAMING_ROWS \
+  (KC_ESC , KC_Q   , KC_W   , KC_E   , KC_R   , KC_T   , KC_Y   , KC_U   , KC_I   , KC_O   , KC_P   , KC_BSPC), \
+  (KC_TAB , KC_A   , KC_S   , KC_D   , KC_F   , KC_G   , KC_H   , KC_J   , KC_K   , KC_L   , BR_SCLN, KC_QUOT), \
+  (KC_LSFT, KC_Z   , KC_X   , KC_C   , KC_V   , KC_B   , KC_N   , KC_M   , KC_COMM, KC_DOT , BR_SLSH, KC_RSFT), \
+  (KC_LCTL, KC_LGUI, NUMPAD , KC_LALT, LOWER  , KC_SPC , KC_SPC , RAISE  , KC_RALT, UTIL   , KC_ESC , KC_ENT )
+
+// Esc.Cl/Bksp and Shift/En-Sh stay where they are when the hands swap
+#define SWAP_KEEP_0   SWAP_PAIR(0)
+#define SWAP_KEEP_1   0
+#define SWAP_KEEP_2   SWAP_PAIR(0)
+#define SWAP_KEEP_3   0
 
-  /* Qwerty
-    +========+========+========+========+========+========+========+========+========+========+========+========+
-    | __01__ | __02__ | __03__ | __04__ | __05__ | __06__ | __07__ | __08__ | __09__ | __10__ | __11__ | __12__ |
-    +========+========+========+========+========+========+========+========+========+========+========+========+
-    | Esc.Cl | Q      | W      | E      | R      | T      | Y      | U      | I      | O      | P      | Bksp   |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    | Tb/Ctl | A      | S      | D      | F      | G      | H      | J      | K      | L      | ;      | '/Ctl  |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    | Shift  | Z      | X      | C      | V      | B      | N      | M      | ,      | .      | /      | En/Sh  |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    | Ctrl   | Gui    | Num    | Alt    | Lower  | SpcNav | SpcNav | Raise  | Alt    | OneHnd | Esc/Ut | En/Ctl |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-   */
-  [_QWERTY] = {
-    { ESC_CPL, KC_Q   , KC_W   , KC_E   , KC_R   , KC_T   , KC_Y   , KC_U   , KC_I   , KC_O   , KC_P   , KC_BSPC},
-    { CTL_TAB, KC_A   , KC_S   , KC_D   , KC_F   , KC_G   , KC_H   , KC_J   , KC_K   , KC_L   , BR_SCLN, CTL_QUT},
-    { KC_LSFT, KC_Z   , KC_X   , KC_C   , KC_V   , KC_B   , KC_N   , KC_M   , KC_COMM, KC_DOT , BR_SLSH, SFT_ENT},
-    { KC_LCTL, KC_LGUI, TPTG_NP, KC_LALT, LOWER  , TC_SPC , TC_SPC , RAISE  , KC_RALT, UTIL   , KC_ESC , CTL_ENT}
-  },
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 
+  [_DVORAK]      = LAYER(DVORAK_ROWS),
+  [_QWERTY]      = LAYER(QWERTY_ROWS),
+  [_GAMING]      = LAYER(GAMING_ROWS),
 
-  /* Gaming
-    +========+========+========+========+========+========+========+========+========+========+========+========+
-    | __01__ | __02__ | __03__ | __04__ | __05__ | __06__ | __07__ | __08__ | __09__ | __10__ | __11__ | __12__ |
-    +========+========+========+========+========+========+========+========+========+========+========+========+
-    | Esc.Cl | Q      | W      | E      | R      | T      | Y      | U      | I      | O      | P      | Bksp   |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    | Tb/Ctl | A      | S      | D      | F      | G      | H      | J      | K      | L      | ;      | '/Ctl  |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    | Shift  | Z      | X      | C      | V      | B      | N      | M      | ,      | .      | /      | En/Sh  |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    | Ctrl   | Gui    | Num    | Alt    | Lower  | SpcNav | SpcNav | Raise  | Alt    | OneHnd | Esc/Ut | En/Ctl |
-    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-   */
-  [_GAMING] = {
-    { ESC_CPL, KC_Q   , KC_W   , KC_E   , KC_R   , KC_T   , KC_Y   , KC_U   , KC_I   , KC_O   , KC_P   , KC_BSPC},
-    { CTL_TAB, KC_A   , KC_S   , KC_D   , KC_F   , KC_G   , KC_H   , KC_J   , KC_K   , KC_L   , BR_SCLN, CTL_QUT},
-    { KC_LSFT, KC_Z   , KC_X   , KC_C   , KC_V   , KC_B   , KC_N   , KC_M   , KC_COMM, KC_DOT , BR_SLSH, SFT_ENT},
-    { KC_LCTL, KC_LGUI, TPTG_NP, KC_LALT, LOWER  , TC_SPC , TC_SPC , RAISE  , KC_RALT, UTIL   , KC_ESC , CTL_ENT}
-  },
+  // Swap hands, one mirrored layer per base layer
+  [_DVORAK_SWAP] = SWAP_LAYER(DVORAK_ROWS),
+  [_QWERTY_SWAP] = SWAP_LAYER(QWERTY_ROWS),
+  [_GAMING_SWAP] = SWAP_LAYER(GAMING_ROWS),
 
   /* One Hand Layer - Dvorak
     +========+========+========+========+========+========+========+========+========+========+========+========+
@@ -206,14 +286,14 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
     |        | ª      | º      | °      | ¢      | ¬      | Play   | Next   | Vol-   | Vol+   | Mute   |        |
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    |        |        |        |        |        | MouseC | MouseC | >>><<< |        |        |        |        |
+    |        |        |        |        |        | MouseC | MouseC | >>><<< |        |        | Accent |        |
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
    */
   [_RAISE] = {
     { _______, BR_LBRC, BR_RBRC, BR_SLSH, KC_EQL , BR_NDTD, KC_1   , KC_2   , KC_3   , KC_4   , KC_5   , KC_DEL },
     { _______, KC_EXLM, KC_AT  , KC_HASH, KC_DLR , KC_PERC, KC_6   , KC_7   , KC_8   , KC_9   , KC_0   , BR_PIPE},
     { _______, BR_FORD, BR_MORD, BR_DGRE, BR_CENT, BR_NOT , KC_MPLY, KC_MNXT, KC_VOLD, KC_VOLU, KC_MUTE, _______},
-    { _______, _______, _______, _______, _______, MCURSOR, MCURSOR, _______, _______, _______, _______, _______}
+    { _______, _______, _______, _______, _______, MCURSOR, MCURSOR, _______, _______, _______, ACCENT , _______}
   },
 
   /* TouchCursor
@@ -296,23 +376,43 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
     { _______, _______, TG_NP  , _______, KC_X   , _______, _______, KC_0   , KC_DOT , KC_COMM, KC_PLUS, KC_MINS}
   },
 
+  /* Accent layer - hold Accent on the Raise layer
+    +========+========+========+========+========+========+========+========+========+========+========+========+
+    | __01__ | __02__ | __03__ | __04__ | __05__ | __06__ | __07__ | __08__ | __09__ | __10__ | __11__ | __12__ |
+    +========+========+========+========+========+========+========+========+========+========+========+========+
+    |        | â      | ô      | ê      |        |        |        |        |        |        |        |        |
+    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+    |        | á      | ó      | é      | ú      | í      |        |        |        |        |        |        |
+    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+    |        | ã      | õ      | à      | ü      | ç      |        |        |        |        |        |        |
+    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+    |        |        |        |        |        |        |        | >>><<< |        |        | >>><<< |        |
+    +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
+   */
+  [_ACCENT] = {
+    { _______, PT_ACIR, PT_OCIR, PT_ECIR, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, _______},
+    { _______, PT_AACU, PT_OACU, PT_EACU, PT_UACU, PT_IACU, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, _______},
+    { _______, PT_ATIL, PT_OTIL, PT_AGRV, PT_UTRM, PT_CCDL, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, _______},
+    { _______, _______, _______, _______, _______, _______, _______, _______, _______, _______, _______, _______}
+  },
+
   /* Util layer
     +========+========+========+========+========+========+========+========+========+========+========+========+
     | __01__ | __02__ | __03__ | __04__ | __05__ | __06__ | __07__ | __08__ | __09__ | __10__ | __11__ | __12__ |
     +========+========+========+========+========+========+========+========+========+========+========+========+
-    |        |        | Calc   | MyComp |        |        |        |        | WebRfr | WebFav |        |        |
+    |        |        | Calc   | MyComp |        |        |        |        | WebRfr | WebFav | Trace  | Stats  |
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
     |        | WebBck | WebHom | Cut    | Copy   | Paste  | Undo   | Find   | Mail   | WebStp | WebFwd |        |
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    |        | Power  |        |        |        |        |        |        |        |        |        |        |
+    |        | Power  |        |        |        |        |        |        |        | Light- | Light+ | Light  |
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
     |        | Sleep  | Wake   |        |        |        |        |        |        | >>><<< |        |        |
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
    */
   [_UTIL] = {
-    { XXXXXXX, XXXXXXX, KC_CALC, KC_MYCM, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, KC_WREF, KC_WFAV, XXXXXXX, XXXXXXX},
+    { XXXXXXX, XXXXXXX, KC_CALC, KC_MYCM, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, KC_WREF, KC_WFAV, TRACE  , STATS  },
     { XXXXXXX, KC_WBAK, KC_WHOM, KC_CUT , KC_COPY, KC_PAST, KC_UNDO, KC_FIND, KC_MAIL, KC_WSTP, KC_WFWD, XXXXXXX},
-    { XXXXXXX, KC_PWR , XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX},
+    { XXXXXXX, KC_PWR , XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, BL_DEC , BL_INC , BL_TOGG},
     { XXXXXXX, KC_SLEP, KC_WAKE, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, XXXXXXX, _______, XXXXXXX, XXXXXXX}
   },
 
@@ -324,7 +424,7 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
     |        | Mute   | Vol -  | Vol +  | Prev   | QWERTY | DVORAK | Next   | Play   | Rwd    | Fwd    |        |
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-    |        |        | Intl   |        | CGnorm | AGnorm | AGswap | CGswap |        | Game   |        |        |
+    |        |        | Intl   |        | SwpOff | AGnorm | AGswap | SwpOff |        | Game   |        |        |
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
     |        |        | Reset  |        | >>><<< | OnHnd  | OnHnd  | >>><<< |        |        |        |        |
     +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
@@ -338,12 +438,57 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 
 };
 
+// Saved in the settings blob, written behind once the keys are up
 void persistant_default_layer_set(uint16_t default_layer) {
-  eeconfig_update_default_layer(default_layer);
+  settings_set_default_layer(biton32(default_layer));
   default_layer_set(default_layer);
 }
 
-bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+// The mirrored copy of the current default layer
+static uint8_t swap_layer(void) {
+  return biton32(default_layer_state) - _DVORAK + _DVORAK_SWAP;
+}
+
+// Gaming mode follows the default layer, whichever way it got there. The
+// keyboard is cleared in the old report format before NKRO is forced on or
+// given back, so no key or mod can stay down on the host across the switch.
+// The forced NKRO is never saved: the settings record leaves the bit out, and
+// process_settings() takes the keys core would write eeconfig for.
+static bool gaming;
+
+static void gaming_set(bool on) {
+#ifdef NKRO_ENABLE
+  static bool nkro_before;
+#endif
+
+  gaming = on;
+  chord_passthrough(on);
+  tap_hold_settle();
+  report_filter_passthrough(on);
+  clear_keyboard();
+#ifdef NKRO_ENABLE
+  if (on) {
+    nkro_before = keymap_config.nkro;
+    keymap_config.nkro = true;
+  } else {
+    keymap_config.nkro = nkro_before;
+  }
+#endif
+}
+
+// Swap hands mirrors the base layer while held. Like ACTION_SWAP_HANDS, a
+// tap inside TAPPING_TERM with no other key pressed in between toggles the
+// mirroring instead, until the next tap or SWP_OFF.
+static uint8_t swap_held;
+static uint16_t swap_time;
+static bool swap_tap;
+static bool swap_toggled;
+
+// Esc is down from the first tap of ESC_CPL, or from the plain Esc key
+static bool esc_caps_esc;
+static bool esc_key;
+
+static bool process_record_keymap(uint16_t keycode, keyrecord_t *record) {
   switch (keycode) {
     case QWERTY:
       if (record->event.pressed) {
@@ -363,36 +508,207 @@ bool process_record_user(uint16_t keycode, keyrecord_t *record) {
       }
       return false;
       break;
-    case LOWER:
+    case STATS:
       if (record->event.pressed) {
-        layer_on(_LOWER);
-        update_tri_layer(_LOWER, _RAISE, _NEXUS);
-      } else {
-        layer_off(_LOWER);
-        update_tri_layer(_LOWER, _RAISE, _NEXUS);
+        stats_dump();
+      }
+      return false;
+      break;
+    case TRACE:
+      if (record->event.pressed) {
+        trace_dump();
       }
       return false;
       break;
-    case RAISE:
+    case SWAP_HANDS:
       if (record->event.pressed) {
-        layer_on(_RAISE);
-        update_tri_layer(_LOWER, _RAISE, _NEXUS);
+        swap_tap = true;
+        swap_time = record->event.time;
+        if (!swap_toggled) {
+          swap_held = swap_layer();
+          layer_on(swap_held);
+        }
       } else {
-        layer_off(_RAISE);
-        update_tri_layer(_LOWER, _RAISE, _NEXUS);
+        if (swap_tap && TIMER_DIFF_16(record->event.time, swap_time) < TAPPING_TERM) {
+          swap_toggled = !swap_toggled;
+        }
+        if (!swap_toggled) {
+          layer_off(swap_held);
+        }
       }
       return false;
       break;
+    case SWAP_HANDS_OFF:
+      if (!record->event.pressed) {
+        swap_toggled = false;
+        layer_off(_DVORAK_SWAP);
+        layer_off(_QWERTY_SWAP);
+        layer_off(_GAMING_SWAP);
+      }
+      return false;
+      break;
+    case KC_ESC:
+      esc_key = record->event.pressed;
+      return true;
+      break;
+    case ESC_CPL:
+      // The Esc from the first tap is held as long as the key, so it repeats.
+      // Releases that did not put Esc down leave a held plain Esc alone.
+      if (!record->event.pressed && esc_caps_esc) {
+        unregister_code(KC_ESC);
+        esc_caps_esc = false;
+      }
+      return true;
+      break;
   }
   return true;
 }
 
+// Events replayed by tap_hold and chord come back through here; they are not
+// counted again, and their time is part of the record that replayed them
+bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+  bool replayed = tap_hold_replaying() || chord_replaying();
+  bool result;
+  STATS_RECORD_BEGIN();
+
+  if (!replayed) {
+    stats_edge(record);
+  }
+  if (record->event.pressed && keycode != SWAP_HANDS) {
+    swap_tap = false;
+  }
+  // Tap-hold sends its taps itself, so the queued sequences go out before the
+  // record gets anywhere near it
+  if (!IS_DEAD_KEY(keycode)) {
+    dead_key_flush();
+  }
+  // Gaming keys are all plain, so tap_hold is only asked while it still owns
+  // a key from before the switch. Presses chord held back have been through
+  // tap_hold already.
+  result = (chord_replaying() || (gaming && tap_hold_idle()) || process_tap_hold(keycode, record)) &&
+           process_chord(keycode, record) &&
+           process_dead_key(keycode, record) &&
+           process_mouse_motion(keycode, record) &&
+           process_settings(keycode, record) &&
+           process_record_keymap(keycode, record);
+
+  if (!replayed) {
+    STATS_RECORD_END();
+  }
+  return result;
+}
+
+void matrix_init_user(void) {
+  backlight_pwm_init();
+  chord_init();
+}
+
+// lufa.c only sets its driver after keyboard_init(), so the drivers are wrapped
+// on the first scan. The report filter wraps the stats driver, so latency
+// counts until the report really goes out. The trace driver is innermost and
+// sees the same.
+static void drivers_init(void) {
+  trace_init();
+  stats_init();
+  report_filter_init();
+}
+
+// Dead key sequences go right after the report filter flush, so each one is
+// the first report of its scan and goes out at once
+void matrix_scan_user(void) {
+  static bool drivers_wrapped;
+
+  if (!drivers_wrapped) {
+    drivers_wrapped = true;
+    drivers_init();
+  }
+  settings_task();
+  if (gaming != (default_layer_state == 1UL<<_GAMING)) {
+    gaming_set(!gaming);
+  }
+  report_filter_task();
+  dead_key_task();
+  stats_scan();
+  trace_task();
+  chord_task();
+  tap_hold_task();
+  mouse_motion_task();
+  eeprom_cache_task();
+}
+
+// Shift on the right pinky is used for capitals mid-word, so it never takes the
+// typing streak shortcut. The corner Ctrl/Enter is almost always a modifier.
+const tap_hold_key_t PROGMEM tap_hold_keys[] = {
+  [TH_CTL_TAB]  = TAP_HOLD_MOD(KC_TAB, KC_LCTL, TAPPING_TERM, TH_PERMISSIVE_HOLD | TH_TYPING_STREAK),
+  [TH_CTL_MNS]  = TAP_HOLD_MOD(KC_MINS, KC_LCTL, TAPPING_TERM, TH_PERMISSIVE_HOLD | TH_TYPING_STREAK),
+  [TH_CTL_QUT]  = TAP_HOLD_MOD(KC_QUOT, KC_LCTL, TAPPING_TERM, TH_PERMISSIVE_HOLD | TH_TYPING_STREAK),
+  [TH_SFT_ENT]  = TAP_HOLD_MOD(KC_ENT, KC_LSFT, TAPPING_TERM, TH_PERMISSIVE_HOLD),
+  [TH_CTL_ENT]  = TAP_HOLD_MOD(KC_ENT, KC_LCTL, TAPPING_TERM, TH_HOLD_ON_PRESS),
+  [TH_TC_SPC]   = TAP_HOLD_LAYER(KC_SPC, _TOUCHCURSOR, TAPPING_TERM, TH_PERMISSIVE_HOLD | TH_TYPING_STREAK),
+};
+
+// Sorted by first bit. Lower and Raise held together add Nexus on top of both,
+// the tri-layer. With ALT_MENU_CHORD, both Alts pressed together send Menu.
+const chord_t PROGMEM chords[] = {
+#ifdef ALT_MENU_CHORD
+  CHORD_KEY(KC_APP, CHORD_KEY_BIT(3, 3), CHORD_KEY_BIT(3, 8)),
+#endif
+  CHORD_LAYER(_LOWER, CHORD_ROLE_BIT(CR_LOWER)),
+  CHORD_LAYER(_NEXUS, CHORD_ROLE_BIT(CR_LOWER), CHORD_ROLE_BIT(CR_RAISE)),
+  CHORD_LAYER(_RAISE, CHORD_ROLE_BIT(CR_RAISE)),
+};
+
+const uint8_t PROGMEM chords_len = sizeof(chords) / sizeof(chords[0]);
+
+// chord.c keeps the layer chords turned on in a 32-bit mask
+_Static_assert(sizeof(chords) / sizeof(chords[0]) <= CHORD_MAX, "more chords than CHORD_MAX");
+
+// Sequences for a host set to ABNT2, where ´ and ~ are dead keys and ` and ^
+// are their shifted halves. Ç has a key of its own but goes through the queue
+// too, so it cannot overtake the letters before it.
+const uint16_t PROGMEM dead_key_seqs[] = {
+  [DK_A_ACUT]   = DEAD_KEY_SEQ(BR_ACUT, KC_A),
+  [DK_A_GRAV]   = DEAD_KEY_SEQ(BR_GRAV, KC_A),
+  [DK_A_CIRC]   = DEAD_KEY_SEQ(BR_CIRC, KC_A),
+  [DK_A_TILD]   = DEAD_KEY_SEQ(BR_TILD, KC_A),
+  [DK_E_ACUT]   = DEAD_KEY_SEQ(BR_ACUT, KC_E),
+  [DK_E_CIRC]   = DEAD_KEY_SEQ(BR_CIRC, KC_E),
+  [DK_I_ACUT]   = DEAD_KEY_SEQ(BR_ACUT, KC_I),
+  [DK_O_ACUT]   = DEAD_KEY_SEQ(BR_ACUT, KC_O),
+  [DK_O_CIRC]   = DEAD_KEY_SEQ(BR_CIRC, KC_O),
+  [DK_O_TILD]   = DEAD_KEY_SEQ(BR_TILD, KC_O),
+  [DK_U_ACUT]   = DEAD_KEY_SEQ(BR_ACUT, KC_U),
+  [DK_U_TRMA]   = DEAD_KEY_SEQ(BR_TRMA, KC_U),
+  [DK_C_CEDL]   = DEAD_KEY_SEQ(KC_NO, BR_CCDL),
+};
+
 const uint16_t PROGMEM fn_actions[] = {
-  [FN_SWAP_HANDS] = ACTION_SWAP_HANDS(),
-  [FN_SWAP_HDOFF] = ACTION_SWAP_HANDS_OFF(),
   [FN_TGGL_NUMPD] = ACTION_LAYER_TAP_TOGGLE(_NUMPAD),
 };
 
+// Esc goes down on the first press instead of after TAPPING_TERM and comes up
+// with the key (see process_record_keymap); a second tap inside the window
+// upgrades it to Caps Lock, after tapping ESC_CAPS_UNDO, and each further tap
+// toggles Caps Lock again.
+void td_esc_caps_each(qk_tap_dance_state_t *state, void *user_data) {
+  switch (state->count) {
+    case 1:
+      if (!esc_key) {
+        register_code(KC_ESC);
+        esc_caps_esc = true;
+      }
+      break;
+    default:
+      if (ESC_CAPS_UNDO != KC_NO) {
+        register_code(ESC_CAPS_UNDO);
+        unregister_code(ESC_CAPS_UNDO);
+      }
+      register_code(KC_CAPS);
+      unregister_code(KC_CAPS);
+      break;
+  }
+}
+
 qk_tap_dance_action_t tap_dance_actions[] = {
-  [TD_ESC_CAPS]  = ACTION_TAP_DANCE_DOUBLE(KC_ESC, KC_CAPS)
+  [TD_ESC_CAPS]  = ACTION_TAP_DANCE_FN_ADVANCED(td_esc_caps_each, NULL, NULL)
 };
\ No newline at end of file
@@ -0,0 +1,478 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include "matrix.h"
+#include "print.h"
+#include "timer.h"
+#include "util.h"
+#include "matrix_ring.h"
+#include "tick.h"
+#include "trace.h"
+
+#define RING_MASK       (MATRIX_RING_SIZE - 1)
+#define DEBOUNCE_SCANS  (DEBOUNCING_DELAY * 1000UL / MATRIX_SCAN_US)
+#define IDLE_PASSES     (MATRIX_IDLE_MS * 1000UL / MATRIX_SCAN_US)
+#define PROBE_DIVIDER   MATRIX_ROWS     // probes are MATRIX_SCAN_US apart
+#define SLEEP_PROBES    ((MATRIX_SLEEP_MS - MATRIX_IDLE_MS) * 1000UL / MATRIX_SCAN_US)
+
+#define EVENT_PRESSED   0x80
+#define EVENT_ROW(e)    (((e) >> 4) & 0x07)
+#define EVENT_COL(e)    ((e) & 0x0F)
+
+typedef struct {
+  uint8_t  key;         // EVENT_PRESSED | row << 4 | col
+  uint16_t time;
+} matrix_event_t;
+
+static const uint8_t row_pins[MATRIX_ROWS] = MATRIX_ROW_PINS;
+static const uint8_t col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
+
+/* Owned by the tick interrupt */
+static matrix_row_t debounced[MATRIX_ROWS];
+static uint8_t current_row;
+static uint16_t quiet_passes;
+static uint32_t probes;
+static volatile uint8_t mode;
+static volatile uint32_t mode_ticks[MATRIX_MODES];
+
+#ifdef DEBOUNCE_EAGER
+#if DEBOUNCE_SCANS > 7
+#error "DEBOUNCE_EAGER counts up to 7 scans, lower DEBOUNCING_DELAY or raise MATRIX_SCAN_US"
+#endif
+#define DEBOUNCE_N      (DEBOUNCE_SCANS ? DEBOUNCE_SCANS : 1)
+#define PLANE(n, bit)   ((((n) >> (bit)) & 1) ? (matrix_row_t)~0 : 0)
+
+/* Three bit-planes per row form a 0..7 counter for each key, so a whole row is
+ * counted with a handful of word operations. cooldown marks keys counting down
+ * after a release, during which they ignore the pins. */
+static matrix_row_t count0[MATRIX_ROWS];
+static matrix_row_t count1[MATRIX_ROWS];
+static matrix_row_t count2[MATRIX_ROWS];
+static matrix_row_t cooldown[MATRIX_ROWS];
+#else
+static matrix_row_t raw[MATRIX_ROWS];
+static uint8_t debouncing;
+#endif
+
+/* Ring: head is written only by the interrupt, tail only by matrix_scan() */
+static volatile matrix_event_t ring[MATRIX_RING_SIZE];
+static volatile uint8_t ring_head;
+static volatile uint8_t ring_tail;
+static bool ring_full;
+
+volatile uint16_t matrix_ring_overruns;
+
+/* Owned by the main loop */
+static matrix_row_t matrix[MATRIX_ROWS];
+static matrix_event_t applied;
+static bool has_applied;
+
+__attribute__ ((weak))
+void matrix_init_quantum(void) {
+  matrix_init_kb();
+}
+
+__attribute__ ((weak))
+void matrix_scan_quantum(void) {
+  matrix_scan_kb();
+}
+
+__attribute__ ((weak))
+void matrix_init_kb(void) {
+  matrix_init_user();
+}
+
+__attribute__ ((weak))
+void matrix_scan_kb(void) {
+  matrix_scan_user();
+}
+
+__attribute__ ((weak))
+void matrix_init_user(void) {
+}
+
+__attribute__ ((weak))
+void matrix_scan_user(void) {
+}
+
+inline
+uint8_t matrix_rows(void) {
+  return MATRIX_ROWS;
+}
+
+inline
+uint8_t matrix_cols(void) {
+  return MATRIX_COLS;
+}
+
+static void init_cols(void) {
+  for (uint8_t x = 0; x < MATRIX_COLS; x++) {
+    uint8_t pin = col_pins[x];
+    _SFR_IO8((pin >> 4) + 1) &= ~_BV(pin & 0xF); // IN
+    _SFR_IO8((pin >> 4) + 2) |=  _BV(pin & 0xF); // HI
+  }
+}
+
+static matrix_row_t read_cols(void) {
+  matrix_row_t state = 0;
+
+  for (uint8_t x = 0; x < MATRIX_COLS; x++) {
+    uint8_t pin = col_pins[x];
+    if (!(_SFR_IO8(pin >> 4) & _BV(pin & 0xF))) {
+      state |= (matrix_row_t)1 << x;
+    }
+  }
+  return state;
+}
+
+static void select_row(uint8_t row) {
+  uint8_t pin = row_pins[row];
+  _SFR_IO8((pin >> 4) + 1) |=  _BV(pin & 0xF); // OUT
+  _SFR_IO8((pin >> 4) + 2) &= ~_BV(pin & 0xF); // LOW
+}
+
+static void unselect_row(uint8_t row) {
+  uint8_t pin = row_pins[row];
+  _SFR_IO8((pin >> 4) + 1) &= ~_BV(pin & 0xF); // IN
+  _SFR_IO8((pin >> 4) + 2) &= ~_BV(pin & 0xF); // LO
+}
+
+static void unselect_rows(void) {
+  for (uint8_t y = 0; y < MATRIX_ROWS; y++) {
+    unselect_row(y);
+  }
+}
+
+static bool ring_push(uint8_t key, uint16_t time) {
+  uint8_t next = (ring_head + 1) & RING_MASK;
+
+  if (next == ring_tail) {
+    if (!ring_full) {
+      trace_key(TRACE_OVERRUN, key);
+    }
+    ring_full = true;
+    matrix_ring_overruns++;
+    return false;
+  }
+  ring[ring_head].key = key;
+  ring[ring_head].time = time;
+  ring_head = next;
+  ring_full = false;
+  trace_key(TRACE_EDGE, key);
+  return true;
+}
+
+// Pushes the keys in bits as edges of one row, lowest column first, and returns
+// the ones that fit. The rest keep their old debounced state and are retried on
+// the next pass.
+static matrix_row_t push_edges(uint8_t row, matrix_row_t bits, bool pressed, uint16_t now) {
+  matrix_row_t pushed = 0;
+
+  for (uint8_t x = 0; bits >> x; x++) {
+    matrix_row_t bit = (matrix_row_t)1 << x;
+
+    if (!(bits & bit)) {
+      continue;
+    }
+    if (!ring_push((pressed ? EVENT_PRESSED : 0) | (row << 4) | x, now)) {
+      break;
+    }
+    pushed |= bit;
+  }
+  return pushed;
+}
+
+#ifdef DEBOUNCE_EAGER
+
+static void count_up(uint8_t row, matrix_row_t mask) {
+  matrix_row_t carry0 = count0[row] & mask;
+  matrix_row_t carry1 = count1[row] & carry0;
+
+  count0[row] ^= mask;
+  count1[row] ^= carry0;
+  count2[row] ^= carry1;
+}
+
+static void count_down(uint8_t row, matrix_row_t mask) {
+  matrix_row_t borrow0 = ~count0[row] & mask;
+  matrix_row_t borrow1 = ~count1[row] & borrow0;
+
+  count0[row] ^= mask;
+  count1[row] ^= borrow0;
+  count2[row] ^= borrow1;
+}
+
+static void count_clear(uint8_t row, matrix_row_t mask) {
+  count0[row] &= ~mask;
+  count1[row] &= ~mask;
+  count2[row] &= ~mask;
+}
+
+// Presses go out on the first sample that sees them. A release needs
+// DEBOUNCE_N consecutive released samples, so contact bounce while the key is
+// down never splits the press, and the key then ignores the pins for another
+// DEBOUNCE_N samples so release bounce cannot start a new press.
+static void debounce_row(uint8_t row, matrix_row_t cols) {
+  uint16_t now = timer_read();
+  matrix_row_t idle = ~cooldown[row];
+  matrix_row_t differ = (cols ^ debounced[row]) & idle;
+  matrix_row_t presses = differ & cols;
+  matrix_row_t releases = differ & ~cols;
+  matrix_row_t due = releases & ~((count0[row] ^ PLANE(DEBOUNCE_N - 1, 0)) |
+                                  (count1[row] ^ PLANE(DEBOUNCE_N - 1, 1)) |
+                                  (count2[row] ^ PLANE(DEBOUNCE_N - 1, 2)));
+  matrix_row_t released = 0;
+
+  if (presses) {
+    debounced[row] |= push_edges(row, presses, true, now);
+  }
+  if (due) {
+    released = push_edges(row, due, false, now);
+    debounced[row] &= ~released;
+  }
+
+  // Agreeing keys start over, releases count on (a due release that did not
+  // fit in the ring stays due), and keys released now count up to DEBOUNCE_N
+  // to start their cooldown.
+  count_clear(row, idle & ~differ);
+  count_up(row, (releases & ~due) | released);
+  count_down(row, cooldown[row]);
+  cooldown[row] = (cooldown[row] & (count0[row] | count1[row] | count2[row])) | released;
+}
+
+static void debounce_pass(void) {
+}
+
+static bool debounce_quiet(void) {
+  for (uint8_t y = 0; y < MATRIX_ROWS; y++) {
+    if (debounced[y] | cooldown[y]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#else
+
+static void debounce_row(uint8_t row, matrix_row_t cols) {
+  if (cols != raw[row]) {
+    raw[row] = cols;
+    debouncing = DEBOUNCE_SCANS + 1;
+  }
+}
+
+// Commits every pending edge once the whole matrix has been quiet for
+// DEBOUNCING_DELAY
+static void debounce_pass(void) {
+  uint16_t now = timer_read();
+
+  if (debouncing && --debouncing) {
+    return;
+  }
+  for (uint8_t y = 0; y < MATRIX_ROWS; y++) {
+    matrix_row_t changes = raw[y] ^ debounced[y];
+
+    if (changes) {
+      debounced[y] ^= push_edges(y, changes & raw[y], true, now) |
+                      push_edges(y, changes & ~raw[y], false, now);
+    }
+  }
+}
+
+static bool debounce_quiet(void) {
+  for (uint8_t y = 0; y < MATRIX_ROWS; y++) {
+    if (debounced[y] | raw[y]) {
+      return false;
+    }
+  }
+  return !debouncing;
+}
+
+#endif
+
+#ifdef TRACE_ENABLE
+static matrix_row_t traced[MATRIX_ROWS];
+
+// Records every column whose level differs from the last read of the row
+static void trace_row(uint8_t row, matrix_row_t cols) {
+  matrix_row_t changed = cols ^ traced[row];
+
+  traced[row] = cols;
+  for (uint8_t x = 0; changed >> x; x++) {
+    if (changed & ((matrix_row_t)1 << x)) {
+      trace_key(TRACE_RAW, ((cols >> x) & 1 ? EVENT_PRESSED : 0) | (row << 4) | x);
+    }
+  }
+}
+#else
+#define trace_row(row, cols)
+#endif
+
+static void select_rows(void) {
+  for (uint8_t y = 0; y < MATRIX_ROWS; y++) {
+    select_row(y);
+  }
+}
+
+// With every row low, any key down pulls its column low, so one read per tick
+// stands in for a whole pass. The first probe to see a key goes back to row by
+// row scanning from row 0, which the next tick reads.
+static void probe_tick(void) {
+  if (read_cols()) {
+    unselect_rows();
+    current_row = 0;
+    select_row(current_row);
+    quiet_passes = 0;
+    mode = MATRIX_MODE_ACTIVE;
+    tick_set_divider(1);
+  } else if (mode == MATRIX_MODE_IDLE && ++probes >= SLEEP_PROBES) {
+    mode = MATRIX_MODE_SLEEP;
+  }
+}
+
+// One row per tick: the row selected on the previous tick has had a full tick
+// to settle, so no busy wait is needed before reading it. Ticks are
+// PROBE_DIVIDER times longer outside ACTIVE.
+void matrix_ring_tick(void) {
+  mode_ticks[mode] += mode == MATRIX_MODE_ACTIVE ? 1 : PROBE_DIVIDER;
+  if (mode != MATRIX_MODE_ACTIVE) {
+    probe_tick();
+    return;
+  }
+
+  matrix_row_t cols = read_cols();
+
+  unselect_row(current_row);
+  trace_row(current_row, cols);
+  debounce_row(current_row, cols);
+  if (++current_row == MATRIX_ROWS) {
+    current_row = 0;
+    debounce_pass();
+    if (!debounce_quiet()) {
+      quiet_passes = 0;
+    } else if (++quiet_passes >= IDLE_PASSES) {
+      select_rows();
+      probes = 0;
+      mode = MATRIX_MODE_IDLE;
+      tick_set_divider(PROBE_DIVIDER);
+      return;
+    }
+  }
+  select_row(current_row);
+}
+
+void matrix_init(void) {
+  // To use PORTF disable JTAG with writing JTD bit twice within four cycles.
+  #if (defined(__AVR_AT90USB1286__) || defined(__AVR_ATmega32U4__))
+    MCUCR |= _BV(JTD);
+    MCUCR |= _BV(JTD);
+  #endif
+
+  unselect_rows();
+  init_cols();
+  current_row = 0;
+  select_row(current_row);
+  tick_init();
+
+  matrix_init_quantum();
+}
+
+// Hands one edge from the ring to keyboard_task per call. keyboard_task acts on
+// a single matrix change per iteration and only sees the difference between two
+// scans, so one edge at a time keeps edges in the order they happened and a tap
+// shorter than a main loop iteration still arrives as a press and a release.
+uint8_t matrix_scan(void) {
+  has_applied = ring_tail != ring_head;
+
+  // Nothing else wakes the main loop up in sleep mode: the tick or the 1 ms
+  // timer brings it back, well inside one pass
+  if (!has_applied && mode == MATRIX_MODE_SLEEP) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+  }
+
+  if (has_applied) {
+    applied = ring[ring_tail];
+
+    matrix_row_t bit = (matrix_row_t)1 << EVENT_COL(applied.key);
+    if (applied.key & EVENT_PRESSED) {
+      matrix[EVENT_ROW(applied.key)] |= bit;
+    } else {
+      matrix[EVENT_ROW(applied.key)] &= ~bit;
+    }
+    ring_tail = (ring_tail + 1) & RING_MASK;
+  }
+
+  matrix_scan_quantum();
+  return 1;
+}
+
+uint8_t matrix_mode(void) {
+  return mode;
+}
+
+uint32_t matrix_mode_ms(uint8_t which) {
+  uint32_t ticks;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    ticks = mode_ticks[which];
+  }
+  return ticks * TICK_US / 1000;
+}
+
+void matrix_mode_clear(void) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    for (uint8_t i = 0; i < MATRIX_MODES; i++) {
+      mode_ticks[i] = 0;
+    }
+  }
+}
+
+uint16_t matrix_edge_time(keyevent_t event) {
+  uint8_t wanted = (event.key.row << 4) | event.key.col;
+
+  if (event.pressed) {
+    wanted |= EVENT_PRESSED;
+  }
+  // Odd like every event time, and rounded down: a time past timer_read()
+  // would make timer_elapsed() from it wrap around
+  if (has_applied && applied.key == wanted) {
+    return (applied.time - 1) | 1;
+  }
+  return event.time;
+}
+
+bool matrix_is_modified(void) {
+  return has_applied;
+}
+
+inline
+bool matrix_is_on(uint8_t row, uint8_t col) {
+  return (matrix[row] & ((matrix_row_t)1 << col));
+}
+
+inline
+matrix_row_t matrix_get_row(uint8_t row) {
+  return matrix[row];
+}
+
+void matrix_print(void) {
+  print("\nr/c 0123456789ABCDEF\n");
+  for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+    phex(row); print(": ");
+    print_bin_reverse16(matrix_get_row(row));
+    print("\n");
+  }
+}
+
+uint8_t matrix_key_count(void) {
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+    count += bitpop16(matrix[i]);
+  }
+  return count;
+}
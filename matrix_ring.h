@@ -0,0 +1,74 @@
+#ifndef MATRIX_RING_H
+#define MATRIX_RING_H
+
+#include "quantum.h"
+
+/*
+ * Timer driven matrix scan
+ *
+ * The matrix is sampled from the timer 3 tick (tick.c), one row per tick,
+ * and every debounced edge is pushed with its timestamp into a single-producer
+ * single-consumer ring. matrix_scan() only drains the ring, so a slow action
+ * in the main loop delays when an edge is processed but never whether or when
+ * it was seen.
+ */
+
+/* Time for a full pass over all rows */
+#ifndef MATRIX_SCAN_US
+#define MATRIX_SCAN_US          1000
+#endif
+
+/* Time with no key down before switching to probing, then to sleeping */
+#ifndef MATRIX_IDLE_MS
+#define MATRIX_IDLE_MS          1000
+#endif
+
+#ifndef MATRIX_SLEEP_MS
+#define MATRIX_SLEEP_MS         10000
+#endif
+
+/* Must be a power of two */
+#ifndef MATRIX_RING_SIZE
+#define MATRIX_RING_SIZE        16
+#endif
+
+/* Time the scan saw the edge behind event, or event.time when the edge was
+ * not handed over by the current matrix_scan() */
+uint16_t matrix_edge_time(keyevent_t event);
+
+/*
+ * Scan modes
+ *
+ * ACTIVE scans row by row. After MATRIX_IDLE_MS with no key down, IDLE drives
+ * every row low and stretches the tick to MATRIX_SCAN_US, reading the columns
+ * once per tick, so the rows stop toggling and the interrupt runs a quarter as
+ * often. After MATRIX_SLEEP_MS, SLEEP also idles the CPU in matrix_scan()
+ * until the next interrupt instead of spinning the main loop. A slower probe
+ * would not let it sleep longer: timer 0 wakes it every millisecond anyway.
+ *
+ * A key pressed in IDLE or SLEEP is seen by the next probe and its row read
+ * within one more pass, so it arrives at most MATRIX_SCAN_US later than in
+ * ACTIVE.
+ * Pin change interrupts cannot do the waking here: only B0 and B4 of the
+ * twelve column pins have one.
+ */
+enum matrix_modes {
+  MATRIX_MODE_ACTIVE,
+  MATRIX_MODE_IDLE,
+  MATRIX_MODE_SLEEP,
+  MATRIX_MODES
+};
+
+uint8_t matrix_mode(void);
+
+/* Time spent in each mode since the last matrix_mode_clear() */
+uint32_t matrix_mode_ms(uint8_t mode);
+void matrix_mode_clear(void);
+
+/* Samples the next row, called from the tick interrupt */
+void matrix_ring_tick(void);
+
+/* Edges that had to wait a scan because the ring was full */
+extern volatile uint16_t matrix_ring_overruns;
+
+#endif
@@ -0,0 +1,194 @@
+#include "host.h"
+#include "timer.h"
+#include "mouse_motion.h"
+
+#define MOVE_UP         0x01
+#define MOVE_DOWN       0x02
+#define MOVE_LEFT       0x04
+#define MOVE_RIGHT      0x08
+#define WHEEL_UP        0x10
+#define WHEEL_DOWN      0x20
+#define WHEEL_LEFT      0x40
+#define WHEEL_RIGHT     0x80
+
+#define MOVE_ANY        (MOVE_UP | MOVE_DOWN | MOVE_LEFT | MOVE_RIGHT)
+#define WHEEL_ANY       (WHEEL_UP | WHEEL_DOWN | WHEEL_LEFT | WHEEL_RIGHT)
+
+#define STEP_TICKS      (MOUSE_MOTION_STEP / MOUSE_MOTION_INTERVAL ? MOUSE_MOTION_STEP / MOUSE_MOTION_INTERVAL : 1)
+
+typedef struct {
+  uint16_t straight;
+  uint16_t diagonal;
+} mouse_speed_t;
+
+// Units per second, to 8.8 fixed point units per report; diagonals are scaled
+// by 181/256, about 1/sqrt(2), so moving on both axes keeps the same speed
+#define SPEED(per_sec)  { (per_sec) * 256UL * MOUSE_MOTION_INTERVAL / 1000, \
+                          (per_sec) * 181UL * MOUSE_MOTION_INTERVAL / 1000 }
+
+#define CURVE_STEPS     16
+
+static const mouse_speed_t PROGMEM move_curve[CURVE_STEPS] = {
+  SPEED(200),  SPEED(207),  SPEED(228),  SPEED(264),
+  SPEED(314),  SPEED(378),  SPEED(456),  SPEED(548),
+  SPEED(655),  SPEED(776),  SPEED(911),  SPEED(1060),
+  SPEED(1224), SPEED(1402), SPEED(1594), SPEED(1800),
+};
+
+static const mouse_speed_t PROGMEM wheel_curve[CURVE_STEPS] = {
+  SPEED(8),    SPEED(8),    SPEED(9),    SPEED(9),
+  SPEED(10),   SPEED(12),   SPEED(13),   SPEED(15),
+  SPEED(17),   SPEED(20),   SPEED(22),   SPEED(25),
+  SPEED(28),   SPEED(32),   SPEED(36),   SPEED(40),
+};
+
+// KC_ACL0, KC_ACL1, KC_ACL2
+static const mouse_speed_t PROGMEM move_fixed[3] = {
+  SPEED(100),  SPEED(400),  SPEED(1600),
+};
+
+static const mouse_speed_t PROGMEM wheel_fixed[3] = {
+  SPEED(4),    SPEED(12),   SPEED(40),
+};
+
+static uint8_t directions;
+static uint8_t buttons;
+static uint8_t accel;           // 0 to ramp, else ACL level + 1
+
+static uint8_t move_step;
+static uint8_t wheel_step;
+static uint8_t step_ticks;
+static uint16_t last_tick;
+
+static uint8_t frac_x;
+static uint8_t frac_y;
+static uint8_t frac_v;
+static uint8_t frac_h;
+
+static uint16_t read_speed(const mouse_speed_t *speed, bool diagonal) {
+  return diagonal ? pgm_read_word(&speed->diagonal) : pgm_read_word(&speed->straight);
+}
+
+static int8_t advance(uint8_t *frac, uint16_t speed, bool negative) {
+  uint16_t acc = *frac + speed;
+  uint8_t units = acc >> 8;
+
+  *frac = acc;
+  if (units > 127) {
+    units = 127;
+  }
+  return negative ? -units : units;
+}
+
+static void send_report(int8_t x, int8_t y, int8_t v, int8_t h) {
+  report_mouse_t report = {
+    .buttons = buttons,
+    .x = x,
+    .y = y,
+    .v = v,
+    .h = h,
+  };
+  host_mouse_send(&report);
+}
+
+static void tick(void) {
+  const mouse_speed_t *move = accel ? &move_fixed[accel - 1] : &move_curve[move_step];
+  const mouse_speed_t *wheel = accel ? &wheel_fixed[accel - 1] : &wheel_curve[wheel_step];
+  uint8_t moving = directions & MOVE_ANY;
+  uint8_t scrolling = directions & WHEEL_ANY;
+  uint16_t speed;
+  int8_t x = 0, y = 0, v = 0, h = 0;
+
+  if (moving) {
+    speed = read_speed(move, (moving & (MOVE_UP | MOVE_DOWN)) && (moving & (MOVE_LEFT | MOVE_RIGHT)));
+    if (moving & (MOVE_UP | MOVE_DOWN)) {
+      y = advance(&frac_y, speed, moving & MOVE_UP);
+    }
+    if (moving & (MOVE_LEFT | MOVE_RIGHT)) {
+      x = advance(&frac_x, speed, moving & MOVE_LEFT);
+    }
+  }
+  if (scrolling) {
+    speed = read_speed(wheel, (scrolling & (WHEEL_UP | WHEEL_DOWN)) && (scrolling & (WHEEL_LEFT | WHEEL_RIGHT)));
+    if (scrolling & (WHEEL_UP | WHEEL_DOWN)) {
+      v = advance(&frac_v, speed, scrolling & WHEEL_DOWN);
+    }
+    if (scrolling & (WHEEL_LEFT | WHEEL_RIGHT)) {
+      h = advance(&frac_h, speed, scrolling & WHEEL_LEFT);
+    }
+  }
+
+  if (++step_ticks >= STEP_TICKS) {
+    step_ticks = 0;
+    if (moving && move_step < CURVE_STEPS - 1) {
+      move_step++;
+    }
+    if (scrolling && wheel_step < CURVE_STEPS - 1) {
+      wheel_step++;
+    }
+  }
+
+  if (x || y || v || h) {
+    send_report(x, y, v, h);
+  }
+}
+
+bool process_mouse_motion(uint16_t keycode, keyrecord_t *record) {
+  bool pressed = record->event.pressed;
+  uint8_t bit;
+
+  if (!IS_MOUSEKEY(keycode)) {
+    return true;
+  }
+
+  if (IS_MOUSEKEY_BUTTON(keycode)) {
+    bit = 1 << (keycode - KC_MS_BTN1);
+    buttons = pressed ? buttons | bit : buttons & ~bit;
+    send_report(0, 0, 0, 0);
+    return false;
+  }
+
+  if (IS_MOUSEKEY_ACCEL(keycode)) {
+    uint8_t level = keycode - KC_MS_ACCEL0 + 1;
+    if (pressed) {
+      accel = level;
+    } else if (accel == level) {
+      accel = 0;
+    }
+    return false;
+  }
+
+  if (IS_MOUSEKEY_MOVE(keycode)) {
+    bit = MOVE_UP << (keycode - KC_MS_UP);
+    if (pressed && !(directions & MOVE_ANY)) {
+      move_step = 0;
+      frac_x = frac_y = 0;
+    }
+  } else {
+    bit = WHEEL_UP << (keycode - KC_MS_WH_UP);
+    if (pressed && !(directions & WHEEL_ANY)) {
+      wheel_step = 0;
+      frac_v = frac_h = 0;
+    }
+  }
+
+  if (pressed) {
+    // Move on the press itself rather than on the next interval
+    if (!directions) {
+      step_ticks = 0;
+      last_tick = timer_read() - MOUSE_MOTION_INTERVAL;
+    }
+    directions |= bit;
+  } else {
+    directions &= ~bit;
+  }
+  return false;
+}
+
+void mouse_motion_task(void) {
+  if (!directions || timer_elapsed(last_tick) < MOUSE_MOTION_INTERVAL) {
+    return;
+  }
+  last_tick += MOUSE_MOTION_INTERVAL;
+  tick();
+}
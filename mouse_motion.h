@@ -0,0 +1,44 @@
+#ifndef MOUSE_MOTION_H
+#define MOUSE_MOTION_H
+
+#include "quantum.h"
+
+/*
+ * Mouse key motion engine
+ *
+ * Takes over the KC_MS_*, KC_BTN*, KC_WH_* and KC_ACL* keys from the core
+ * mousekey code. Cursor and wheel speeds come from PROGMEM acceleration curves
+ * stored in 8.8 fixed point units per report, already scaled for
+ * MOUSE_MOTION_INTERVAL and for diagonals, so a report costs a table read, an
+ * add and a shift per axis, with no multiply or divide. The fraction left over
+ * on each axis carries into the next report, so slow speeds still move
+ * smoothly instead of rounding down to zero.
+ *
+ * While an ACL key is held the speed is fixed at its level; otherwise it ramps
+ * along the curve, one step every MOUSE_MOTION_STEP ms.
+ */
+
+/* Time between reports while moving, in ms */
+#ifndef MOUSE_MOTION_INTERVAL
+#define MOUSE_MOTION_INTERVAL   10
+#endif
+
+/* The mouse endpoint is polled every 10 ms (its bInterval in lufa's
+ * descriptor.c). Reports made faster than that only wait for the endpoint,
+ * stalling the main loop, so shorter intervals are raised to it. */
+#define MOUSE_MOTION_EP_INTERVAL 10
+
+#if MOUSE_MOTION_INTERVAL < MOUSE_MOTION_EP_INTERVAL
+#undef MOUSE_MOTION_INTERVAL
+#define MOUSE_MOTION_INTERVAL   MOUSE_MOTION_EP_INTERVAL
+#endif
+
+/* Time spent on each step of the acceleration curve, in ms */
+#ifndef MOUSE_MOTION_STEP
+#define MOUSE_MOTION_STEP       40
+#endif
+
+bool process_mouse_motion(uint16_t keycode, keyrecord_t *record);
+void mouse_motion_task(void);
+
+#endif
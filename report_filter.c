@@ -0,0 +1,112 @@
+#include <string.h>
+#include "host.h"
+#include "host_driver.h"
+#include "report_filter.h"
+
+extern keymap_config_t keymap_config;
+
+static host_driver_t *driver;
+static host_driver_t filter_driver;
+
+static report_keyboard_t last_keyboard;
+static report_keyboard_t pending_keyboard;
+static bool keyboard_pending;
+static bool sent_this_scan;
+
+static report_mouse_t last_mouse;
+
+static bool passthrough;
+
+uint16_t report_filter_sent;
+uint16_t report_filter_merged;
+uint16_t report_filter_skipped;
+
+static bool nkro_active(void) {
+#ifdef NKRO_ENABLE
+  return keyboard_protocol && keymap_config.nkro;
+#else
+  return false;
+#endif
+}
+
+// True when to differs from from only by keys released. Only NKRO reports are
+// merged, so without NKRO nothing is.
+static bool releases_only(const report_keyboard_t *from, const report_keyboard_t *to) {
+#ifdef NKRO_ENABLE
+  if (from->nkro.mods != to->nkro.mods) {
+    return false;
+  }
+  for (uint8_t i = 0; i < sizeof(to->nkro.bits); i++) {
+    if (to->nkro.bits[i] & ~from->nkro.bits[i]) {
+      return false;
+    }
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+static void send_now(report_keyboard_t *report) {
+  last_keyboard = *report;
+  report_filter_sent++;
+  sent_this_scan = true;
+  driver->send_keyboard(&last_keyboard);
+}
+
+static void flush_keyboard(void) {
+  if (keyboard_pending) {
+    keyboard_pending = false;
+    send_now(&pending_keyboard);
+  }
+}
+
+static void send_keyboard(report_keyboard_t *report) {
+  const report_keyboard_t *current = keyboard_pending ? &pending_keyboard : &last_keyboard;
+
+  if (!memcmp(report, current, sizeof(report_keyboard_t))) {
+    report_filter_skipped++;
+    return;
+  }
+  if (passthrough || !nkro_active() || !sent_this_scan || !releases_only(current, report)) {
+    flush_keyboard();
+    send_now(report);
+    return;
+  }
+  if (keyboard_pending) {
+    report_filter_merged++;
+  }
+  pending_keyboard = *report;
+  keyboard_pending = true;
+}
+
+// Relative motion is never a duplicate; an idle report only matters when the
+// buttons change
+static void send_mouse(report_mouse_t *report) {
+  if (!report->x && !report->y && !report->v && !report->h &&
+      report->buttons == last_mouse.buttons) {
+    report_filter_skipped++;
+    return;
+  }
+  last_mouse = *report;
+  report_filter_sent++;
+  driver->send_mouse(report);
+}
+
+void report_filter_init(void) {
+  driver = host_get_driver();
+  filter_driver = *driver;
+  filter_driver.send_keyboard = send_keyboard;
+  filter_driver.send_mouse = send_mouse;
+  host_set_driver(&filter_driver);
+}
+
+void report_filter_task(void) {
+  flush_keyboard();
+  sent_this_scan = false;
+}
+
+void report_filter_passthrough(bool on) {
+  flush_keyboard();
+  passthrough = on;
+}
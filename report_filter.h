@@ -0,0 +1,30 @@
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include "quantum.h"
+
+/*
+ * HID report coalescing
+ *
+ * Sits between the core and the USB driver. Keyboard and mouse reports
+ * identical to the last one sent are dropped; host.c already does that for
+ * system and consumer reports, which go straight through. With NKRO active,
+ * the first keyboard report of a scan goes out at once and the following ones
+ * that only release keys are merged; the merged report goes out at the start
+ * of the next scan. A report that presses a key or changes modifiers flushes
+ * what is held back and is sent on its own, so two presses never reach the
+ * host as one and RALT()/LSFT() keys still reach the host modifier first, as
+ * dead keys need.
+ */
+
+void report_filter_init(void);
+void report_filter_task(void);
+
+/* Send every report as it comes, flushing anything held back */
+void report_filter_passthrough(bool on);
+
+extern uint16_t report_filter_sent;
+extern uint16_t report_filter_merged;
+extern uint16_t report_filter_skipped;
+
+#endif
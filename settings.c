@@ -0,0 +1,165 @@
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include "settings.h"
+#include "eeprom_cache.h"
+#include "action_layer.h"
+#include "util.h"
+#ifdef BACKLIGHT_ENABLE
+#include "backlight.h"
+#endif
+
+extern keymap_config_t keymap_config;
+#ifdef BACKLIGHT_ENABLE
+extern backlight_config_t backlight_config;
+#endif
+
+#define FIELD_OFFSET(field) ((uint8_t *)&settings.field - (uint8_t *)&settings)
+
+static settings_t settings;
+static bool loaded;
+static bool stored;                     // EEPROM holds a valid record
+
+static uint8_t settings_crc(void) {
+  const uint8_t *p = (const uint8_t *)&settings;
+  uint8_t crc = 0;
+
+  for (uint8_t i = 0; i < sizeof(settings_t) - 1; i++) {
+    crc = _crc8_ccitt_update(crc, p[i]);
+  }
+  return crc;
+}
+
+static uint8_t nkro_mask(void) {
+  keymap_config_t nkro = { .raw = 0 };
+
+  nkro.nkro = true;
+  return nkro.raw;
+}
+
+static void store(void) {
+  const uint8_t *p = (const uint8_t *)&settings;
+
+  for (uint8_t i = 0; i < sizeof(settings_t); i++) {
+    eeprom_cache_write_byte(SETTINGS_ADDR + i, p[i]);
+  }
+  stored = true;
+}
+
+// The record for what core has loaded from eeconfig. It is written out at
+// once, so this happens on the first boot only.
+static void seed(void) {
+  settings.version = SETTINGS_VERSION;
+  settings.default_layer = biton32(default_layer_state);
+  settings.keymap = keymap_config.raw & ~nkro_mask();
+  settings.backlight = 0;
+#ifdef BACKLIGHT_ENABLE
+  settings.backlight = backlight_config.raw;
+#endif
+  settings.crc = settings_crc();
+  store();
+}
+
+static void load(void) {
+  eeprom_read_block(&settings, SETTINGS_ADDR, sizeof(settings_t));
+  stored = settings.version == SETTINGS_VERSION && settings.crc == settings_crc();
+  if (!stored) {
+    seed();
+    return;
+  }
+
+  default_layer_set(1UL << settings.default_layer);
+  keymap_config.raw = (keymap_config.raw & nkro_mask()) | (settings.keymap & ~nkro_mask());
+#ifdef BACKLIGHT_ENABLE
+  backlight_config.raw = settings.backlight;
+  backlight_set(backlight_config.enable ? backlight_config.level : 0);
+#endif
+}
+
+// Queues the changed byte and the CRC, or the whole record when the EEPROM
+// copy is not valid yet
+static void update(uint8_t offset, uint8_t value) {
+  uint8_t *p = (uint8_t *)&settings;
+
+  if (p[offset] == value) {
+    return;
+  }
+  p[offset] = value;
+  settings.crc = settings_crc();
+
+  if (stored) {
+    eeprom_cache_write_byte(SETTINGS_ADDR + offset, value);
+    eeprom_cache_write_byte(SETTINGS_ADDR + FIELD_OFFSET(crc), settings.crc);
+  } else {
+    store();
+  }
+}
+
+#ifdef BACKLIGHT_ENABLE
+// backlight.c's steps, minus its eeconfig write
+static void backlight_key(uint16_t keycode) {
+  switch (keycode) {
+    case BL_DEC:
+      if (backlight_config.level > 0) {
+        backlight_config.level--;
+        backlight_config.enable = backlight_config.level != 0;
+      }
+      break;
+    case BL_INC:
+      if (backlight_config.level < BACKLIGHT_LEVELS) {
+        backlight_config.level++;
+        backlight_config.enable = true;
+      }
+      break;
+    case BL_TOGG:
+      backlight_config.enable = !backlight_config.enable;
+      break;
+  }
+  backlight_set(backlight_config.enable ? backlight_config.level : 0);
+}
+#endif
+
+#ifdef BACKLIGHT_ENABLE
+// Core's wakeup reloads the backlight from eeconfig, which no longer follows
+// the backlight keys
+void suspend_wakeup_init_user(void) {
+  if (loaded) {
+    backlight_config.raw = settings.backlight;
+    backlight_set(backlight_config.enable ? backlight_config.level : 0);
+  }
+}
+#endif
+
+bool process_settings(uint16_t keycode, keyrecord_t *record) {
+  switch (keycode) {
+    case MAGIC_SWAP_ALT_GUI:
+    case MAGIC_UNSWAP_ALT_GUI:
+      if (record->event.pressed) {
+        keymap_config.swap_lalt_lgui = keymap_config.swap_ralt_rgui = keycode == MAGIC_SWAP_ALT_GUI;
+        clear_keyboard();
+        update(FIELD_OFFSET(keymap), keymap_config.raw & ~nkro_mask());
+      }
+      return false;
+#ifdef BACKLIGHT_ENABLE
+    case BL_DEC:
+    case BL_INC:
+    case BL_TOGG:
+      if (record->event.pressed) {
+        backlight_key(keycode);
+        update(FIELD_OFFSET(backlight), backlight_config.raw);
+      }
+      return false;
+#endif
+  }
+  return true;
+}
+
+void settings_task(void) {
+  if (!loaded) {
+    load();
+    loaded = true;
+  }
+}
+
+void settings_set_default_layer(uint8_t layer) {
+  update(FIELD_OFFSET(default_layer), layer);
+}
@@ -0,0 +1,46 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include "quantum.h"
+
+/*
+ * Settings blob
+ *
+ * The default layer, keymap_config and the backlight are kept in one
+ * versioned EEPROM record with a CRC-8, loaded with a single block read.
+ * Changes go out through eeprom_cache as the changed byte plus the CRC.
+ *
+ * The record is the only copy written. process_settings() takes AG_SWAP,
+ * AG_NORM and the backlight keys from core, which would write eeconfig for
+ * them, and default layer changes go through settings_set_default_layer().
+ *
+ * Core still reads eeconfig while booting, in keyboard_init() before any keymap
+ * hook runs; a keymap has no way to skip that, so the record does not make boot
+ * shorter. The first settings_task() call, made once core is done, applies a
+ * valid record on top. When there is none, as on the first boot with this
+ * firmware, the record is made from what core loaded and written out whole.
+ * eeconfig is not written after that, so a record later broken by a power loss
+ * mid-update goes back to the settings of that first boot. The NKRO bit of
+ * keymap_config is not saved, so gaming mode forcing NKRO on never is.
+ */
+
+#define SETTINGS_VERSION        1
+
+/* Past the bytes eeconfig uses */
+#ifndef SETTINGS_ADDR
+#define SETTINGS_ADDR           ((uint8_t *)32)
+#endif
+
+typedef struct {
+  uint8_t version;
+  uint8_t default_layer;                // layer number, not a bit mask
+  uint8_t keymap;                       // keymap_config.raw without NKRO
+  uint8_t backlight;                    // backlight_config.raw
+  uint8_t crc;
+} settings_t;
+
+bool process_settings(uint16_t keycode, keyrecord_t *record);
+void settings_task(void);
+void settings_set_default_layer(uint8_t layer);
+
+#endif
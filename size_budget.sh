@@ -0,0 +1,124 @@
+#!/bin/sh
+
+###
+# QMK Firmware - Size budget check
+###
+
+#
+# Builds this keymap as configured, then once more with each build option
+# below flipped, and prints what every option costs in flash and RAM, the
+# biggest symbols of each keymap source and the stack frame of its functions.
+# Exits with 1 when a figure is over its line in size_budget.txt; figures
+# there marked "?" are unmeasured placeholders and only get a warning.
+#
+# Run it from the keymap folder of a checkout made by build.sh. Needs avr-size
+# and avr-nm next to avr-gcc. The stack high-water mark can only be measured on
+# the board: it is the last field typed by the STATS key (see stats.h).
+#
+OPTIONS="BOOTMAGIC MOUSEKEY EXTRAKEY CONSOLE COMMAND NKRO BACKLIGHT MIDI AUDIO UNICODE RGBLIGHT TAP_DANCE STATS TRACE"
+BUDGET_FILE="size_budget.txt"
+ROOT="../../../.."
+KEYMAP_DIR="keyboards/planck/keymaps/bruno"
+LOG="/tmp/size_budget.log"
+
+failed=0
+
+# Prints "<flash> <ram>" of a fresh build with the given make arguments, or
+# nothing when it does not build
+build() {
+  rm -rf "${ROOT}/.build"
+  make "$@" > "${LOG}" 2>&1 || return
+  elf=$(ls -t "${ROOT}"/.build/*.elf 2> /dev/null | head -n 1)
+  [ -n "${elf}" ] || return
+  avr-size --format=berkeley "${elf}" | awk 'NR == 2 { print $1 + $2, $2 + $3 }'
+}
+
+# Default value of an option in the keymap Makefile
+option() {
+  awk -v name="$1_ENABLE" '$1 == name { print $3 }' Makefile
+}
+
+# Budget of a line in the budget file, column 2 for flash and 3 for RAM
+budget() {
+  awk -v name="$1" -v col="$2" '$1 == name { print $col }' "${BUDGET_FILE}"
+}
+
+# A placeholder budget, marked with "?", is reported but does not fail the run
+check() {
+  limit=$(budget "$1" "$2")
+  case "${limit}" in
+    ""|-) return ;;
+  esac
+  if [ "$3" -le "${limit%\?}" ]; then
+    return
+  fi
+  if [ "${limit}" != "${limit%\?}" ]; then
+    echo "  over placeholder budget: $1 $4 $3 > ${limit%\?}"
+  else
+    echo "  over budget: $1 $4 $3 > ${limit}"
+    failed=1
+  fi
+}
+
+echo "Building as configured..."
+base=$(build EXTRAFLAGS=-fstack-usage)
+if [ -z "${base}" ]; then
+  echo "Build failed, see ${LOG}"
+  exit 1
+fi
+set -- ${base}
+base_flash=$1
+base_ram=$2
+printf "%-12s %7s %7s\n" "" "flash" "ram"
+printf "%-12s %7d %7d\n" "TOTAL" "${base_flash}" "${base_ram}"
+check TOTAL 2 "${base_flash}" flash
+check TOTAL 3 "${base_ram}" ram
+
+echo
+echo "Largest symbols (t: flash, d: flash and ram, b: ram)"
+for obj in "${ROOT}"/.build/obj_*/"${KEYMAP_DIR}"/*.o; do
+  echo "  $(basename "${obj}" .o)"
+  avr-nm --size-sort --reverse-sort -S -t d "${obj}" |
+    awk 'NF == 4 { printf "    %6d %s %s\n", $2, tolower($3), $4 }' | head -n 8
+done
+
+echo
+echo "Largest stack frames"
+frame=$(cat "${ROOT}"/.build/obj_*/"${KEYMAP_DIR}"/*.su 2> /dev/null |
+  awk '{ n = split($1, f, ":"); print $2, f[n] }' | sort -rn | head -n 8)
+echo "${frame}" | awk 'NF { printf "  %6d %s\n", $1, $2 }'
+check FRAME 3 "$(echo "${frame}" | awk 'NR == 1 { print $1 + 0 }')" ram
+
+echo
+echo "Option costs, built with each one turned on and off"
+for name in ${OPTIONS}; do
+  value=$(option "${name}")
+  if [ "${value}" = "yes" ]; then
+    other=no
+  else
+    other=yes
+  fi
+  flipped=$(build "${name}_ENABLE=${other}")
+  if [ -z "${flipped}" ]; then
+    printf "%-12s %15s\n" "${name}" "does not build"
+    continue
+  fi
+  set -- ${flipped}
+  if [ "${value}" = "yes" ]; then
+    flash=$((base_flash - $1))
+    ram=$((base_ram - $2))
+  else
+    flash=$(($1 - base_flash))
+    ram=$(($2 - base_ram))
+  fi
+  printf "%-12s %7d %7d  (%s)\n" "${name}" "${flash}" "${ram}" "${value:-no}"
+  check "${name}" 2 "${flash}" flash
+  check "${name}" 3 "${ram}" ram
+done
+
+if grep -q '^[A-Z].*?' "${BUDGET_FILE}"; then
+  echo
+  echo "${BUDGET_FILE} still has placeholder budgets, marked ?; replace them with the figures above"
+fi
+
+exit ${failed}
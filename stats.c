@@ -0,0 +1,260 @@
+#include <avr/io.h>
+#include <util/atomic.h>
+#include "host.h"
+#include "host_driver.h"
+#include "timer.h"
+#include "stats.h"
+#include "matrix_ring.h"
+#include "report_filter.h"
+#include "eeprom_cache.h"
+#include "tick.h"
+
+// Up to 5 digits and a separator a field, 5 more digits for the 32-bit ones
+#define WIDE_FIELDS     (MATRIX_MODES + 1)
+#define STATS_DUMP_SIZE (6 * (STATS_LATENCY_BUCKETS + 19) + 5 * WIDE_FIELDS + 2)
+#define STACK_PAINT     0xC5
+
+/* Current window */
+static uint16_t window_start;
+static uint16_t window_scans;
+static uint16_t scans_per_sec;
+static uint32_t last_scan;
+static uint32_t max_stall;
+static uint32_t record_total;
+static uint16_t record_count;
+static uint16_t record_max;
+static uint16_t latency[STATS_LATENCY_BUCKETS];
+
+/* Timer 0 starts counting in keyboard_init(), before the matrix and eeconfig */
+static uint16_t boot_us;
+static bool booted;
+
+/* Oldest press still waiting for a keyboard report */
+static uint16_t edge_time;
+static bool edge_pending;
+
+static host_driver_t *driver;
+static host_driver_t stats_driver;
+
+#ifdef __AVR__
+/* From the avr-libc linker script: end of .bss and top of RAM */
+extern uint8_t _end;
+extern uint8_t __stack;
+#endif
+
+/* Dump being typed, one character per two scans */
+static char dump[STATS_DUMP_SIZE];
+static uint8_t dump_len;
+static uint8_t dump_pos;
+static bool dump_key_down;
+
+// Time in timer 0 ticks (4 us at 16 MHz), wrapping every 262 ms
+uint16_t stats_now(void) {
+  uint16_t ms = timer_read();
+  uint8_t tick = TCNT0;
+
+  if (timer_read() != ms) {
+    ms++;
+    tick = TCNT0;
+  }
+  return ms * (F_CPU / 64 / 1000) + tick;
+}
+
+// Time in us from the 32-bit ms count, for gaps too long for stats_now()
+static uint32_t stats_now_us(void) {
+  uint32_t ms = timer_read32();
+  uint8_t tick = TCNT0;
+
+  if (timer_read32() != ms) {
+    ms++;
+    tick = TCNT0;
+  }
+  return ms * 1000 + tick * (64 * 1000000UL / F_CPU);
+}
+
+#ifdef __AVR__
+// Runs before main(), while nothing is on the stack yet, and fills the free RAM
+// so stack_free() can see how deep the stack has ever gone
+void stats_paint_stack(void) __attribute__((naked, used, section(".init3")));
+void stats_paint_stack(void) {
+  for (uint8_t *p = &_end; p <= &__stack; p++) {
+    *p = STACK_PAINT;
+  }
+}
+
+static uint16_t stack_free(void) {
+  const uint8_t *p = &_end;
+
+  while (p <= &__stack && *p == STACK_PAINT) {
+    p++;
+  }
+  return p - &_end;
+}
+#else
+// The host harness has no .init3 and no fixed RAM top
+static uint16_t stack_free(void) {
+  return 0;
+}
+#endif
+
+static uint16_t ticks_to_us(uint32_t ticks) {
+  ticks = ticks * 64 / (F_CPU / 1000000);
+  return ticks > UINT16_MAX ? UINT16_MAX : ticks;
+}
+
+static void send_keyboard(report_keyboard_t *report) {
+  if (edge_pending) {
+    uint16_t elapsed = timer_elapsed(edge_time);
+    uint8_t bucket = 0;
+
+    while (elapsed && bucket < STATS_LATENCY_BUCKETS - 1) {
+      elapsed >>= 1;
+      bucket++;
+    }
+    latency[bucket]++;
+    edge_pending = false;
+  }
+  driver->send_keyboard(report);
+}
+
+void stats_init(void) {
+  driver = host_get_driver();
+  stats_driver = *driver;
+  stats_driver.send_keyboard = send_keyboard;
+  host_set_driver(&stats_driver);
+
+  window_start = timer_read();
+  last_scan = stats_now_us();
+}
+
+static void type_dump(void) {
+  char c = dump[dump_pos];
+  uint8_t code;
+
+  if (c == ' ') {
+    code = KC_SPC;
+  } else if (c == '\n') {
+    code = KC_ENT;
+  } else if (c == '0') {
+    code = KC_0;
+  } else {
+    code = KC_1 + (c - '1');
+  }
+
+  if (!dump_key_down) {
+    register_code(code);
+  } else {
+    unregister_code(code);
+    dump_pos++;
+  }
+  dump_key_down = !dump_key_down;
+}
+
+void stats_scan(void) {
+  uint32_t now = stats_now_us();
+  uint32_t stall = now - last_scan;
+
+  if (!booted) {
+    booted = true;
+    boot_us = now > UINT16_MAX ? UINT16_MAX : now;
+  }
+
+  last_scan = now;
+  if (stall > max_stall) {
+    max_stall = stall;
+  }
+
+  window_scans++;
+  if (timer_elapsed(window_start) >= 1000) {
+    scans_per_sec = window_scans;
+    window_scans = 0;
+    window_start += 1000;
+  }
+
+  if (dump_pos < dump_len) {
+    type_dump();
+  }
+}
+
+// A release before any report means the press did not produce one
+void stats_edge(keyrecord_t *record) {
+  if (!record->event.pressed) {
+    edge_pending = false;
+  } else if (!edge_pending) {
+    edge_time = matrix_edge_time(record->event);
+    edge_pending = true;
+  }
+}
+
+void stats_record(uint16_t start) {
+  uint16_t elapsed = stats_now() - start;
+
+  record_total += elapsed;
+  record_count++;
+  if (elapsed > record_max) {
+    record_max = elapsed;
+  }
+}
+
+static void append(uint32_t value, char end) {
+  char digits[10];
+  uint8_t n = 0;
+
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+  while (n) {
+    dump[dump_len++] = digits[--n];
+  }
+  dump[dump_len++] = end;
+}
+
+void stats_dump(void) {
+  uint16_t overruns;
+
+  if (dump_pos < dump_len) {
+    return;
+  }
+  dump_len = 0;
+  dump_pos = 0;
+
+  append(8, ' ');
+  append(scans_per_sec, ' ');
+  append(max_stall, ' ');
+  append(eeprom_cache_stalls, ' ');
+  append(record_count, ' ');
+  append(record_count ? ticks_to_us(record_total / record_count) : 0, ' ');
+  append(ticks_to_us(record_max), ' ');
+  for (uint8_t i = 0; i < STATS_LATENCY_BUCKETS; i++) {
+    append(latency[i], ' ');
+    latency[i] = 0;
+  }
+  append(report_filter_sent, ' ');
+  append(report_filter_merged, ' ');
+  append(report_filter_skipped, ' ');
+  append(tick_isr_max_us(), ' ');
+  append(tick_late, ' ');
+  append(boot_us, ' ');
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    overruns = matrix_ring_overruns;
+    matrix_ring_overruns = 0;
+  }
+  append(overruns, ' ');
+  append(matrix_mode(), ' ');
+  for (uint8_t i = 0; i < MATRIX_MODES; i++) {
+    append(matrix_mode_ms(i) / 1000, ' ');
+  }
+  append(stack_free(), '\n');
+  report_filter_sent = 0;
+  report_filter_merged = 0;
+  report_filter_skipped = 0;
+  eeprom_cache_stalls = 0;
+  tick_stats_clear();
+  matrix_mode_clear();
+
+  max_stall = 0;
+  record_total = 0;
+  record_count = 0;
+  record_max = 0;
+}
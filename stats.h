@@ -0,0 +1,60 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "quantum.h"
+
+/*
+ * Scan rate and latency counters
+ *
+ * Built only with STATS_ENABLE = yes; otherwise every hook below compiles to
+ * nothing. The STATS key types one line of space separated decimal fields and
+ * starts a new measurement window:
+ *
+ *   8 <scans/s> <max stall us> <eeprom stalls> <records> <avg record us>
+ *     <max record us> <h0> .. <h7> <reports sent> <reports merged>
+ *     <reports skipped> <max tick us> <late ticks> <boot us> <ring overruns>
+ *     <scan mode> <active s> <idle s> <sleep s> <stack free>
+ *
+ * The leading 8 is the format version; stats_decode.py reads the line back.
+ * h0..h7 count key presses by the time from the scan seeing the edge to the
+ * keyboard report it produced, in log2 buckets of milliseconds: 0, 1, 2-3,
+ * 4-7, 8-15, 16-31, 32-63, 64 and more. EEPROM stalls are the scans
+ * eeprom_cache.c saw held up by an EEPROM write. The report counts come from
+ * report_filter.c, the tick figures from tick.c: a tick is late when its
+ * interrupt outlasted TICK_US and delayed the next row. Boot time runs from
+ * keyboard_init() to the end of the first matrix_scan_user, which loads the
+ * settings blob. The ring overruns, the scan mode and the seconds spent in each
+ * mode come from matrix_ring.c. Stack free is the RAM above .bss the stack has
+ * never reached since power up; it is not reset by a dump, and reads 0 in the
+ * host harness.
+ * Only digits, space and enter are typed, so the line reads the same under any
+ * host layout.
+ */
+
+#define STATS_LATENCY_BUCKETS   8
+
+#ifdef STATS_ENABLE
+
+void stats_init(void);
+void stats_scan(void);
+void stats_edge(keyrecord_t *record);
+void stats_record(uint16_t start);
+void stats_dump(void);
+uint16_t stats_now(void);
+
+#define STATS_RECORD_BEGIN()    uint16_t stats_record_start = stats_now()
+#define STATS_RECORD_END()      stats_record(stats_record_start)
+
+#else
+
+#define stats_init()
+#define stats_scan()
+#define stats_edge(record)
+#define stats_dump()
+
+#define STATS_RECORD_BEGIN()
+#define STATS_RECORD_END()
+
+#endif
+
+#endif
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+#
+# Decodes the line typed by the STATS key (see stats.h) into one named field
+# per line:
+#
+#   ./stats_decode.py < dump.txt
+#
+# Only the last line is read, so the dump can be typed at the end of any text.
+# The record times are also given in CPU cycles at F_CPU, the cost of one key
+# event through process_record_user on the board, and so is the longest tick
+# interrupt, to the 64 cycles of timer 3's clock.
+# make check in host/ types the dump of traces/stats.txt and compares what
+# this prints with traces/stats.decoded.
+#
+import re
+import sys
+
+VERSION = 8
+F_CPU = 16000000
+BUCKETS = ["0", "1", "2-3", "4-7", "8-15", "16-31", "32-63", "64+"]
+FIELDS = (["scans/s", "max stall us", "eeprom stalls", "records",
+           "avg record us", "max record us"] +
+          ["latency %s ms" % b for b in BUCKETS] +
+          ["reports sent", "reports merged", "reports skipped", "max tick us",
+           "late ticks", "boot us", "ring overruns", "scan mode", "active s",
+           "idle s", "sleep s", "stack free"])
+
+
+# Letters typed right before the dump are skipped; digits would run into the
+# version
+def parse(text):
+    m = re.search(r"(\d+)((?: \d+){%d})\s*$" % len(FIELDS), text)
+    if not m or int(m.group(1)) != VERSION:
+        sys.exit("not a version %d stats line" % VERSION)
+    return [int(v) for v in m.group(2).split()]
+
+
+def main():
+    for name, value in zip(FIELDS, parse(sys.stdin.read())):
+        print("%s %d" % (name, value))
+        if name.endswith("record us") or name == "max tick us":
+            print("%s %d" % (name[:-2] + "cycles", value * (F_CPU // 1000000)))
+
+
+if __name__ == "__main__":
+    main()
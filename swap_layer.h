@@ -0,0 +1,48 @@
+#ifndef SWAP_LAYER_H
+#define SWAP_LAYER_H
+
+#include "quantum.h"
+
+/*
+ * Swap hands with mirrored layers
+ *
+ * A base layer is written once, as a list of parenthesised rows, and expanded
+ * twice: LAYER() as it is and SWAP_LAYER() with every row mirrored left to
+ * right. Swapping hands is then a matter of turning the mirrored layer on;
+ * nothing is remapped per event. Each mirrored layer costs
+ * MATRIX_ROWS * MATRIX_COLS keycodes of flash, 96 bytes on the Planck.
+ *
+ * SWAP_KEEP_0 .. SWAP_KEEP_3 hold one column mask per row, to be defined by
+ * the keymap. Kept positions are transparent in the mirrored layer, so the key
+ * underneath stays where it is. Keep whole pairs (SWAP_PAIR), otherwise one
+ * key shows up on both sides and its mirror disappears.
+ */
+
+#if MATRIX_ROWS != 4 || MATRIX_COLS != 12
+#error "swap_layer.h is written for a 4x12 matrix"
+#endif
+
+#define SWAP_PAIR(col)          ((1U << (col)) | (1U << (MATRIX_COLS - 1 - (col))))
+#define SWAP_KEY(keep, col, kc) ((((keep) >> (col)) & 1) ? KC_TRNS : (kc))
+
+#define SWAP_APPLY(m, ...)      m(__VA_ARGS__)
+#define SWAP_UNPAREN(...)       __VA_ARGS__
+
+#define SWAP_ROW(keep, k0, k1, k2, k3, k4, k5, k6, k7, k8, k9, k10, k11) { \
+    SWAP_KEY(keep, 0, k11), SWAP_KEY(keep, 1, k10), SWAP_KEY(keep,  2, k9), \
+    SWAP_KEY(keep, 3, k8),  SWAP_KEY(keep, 4, k7),  SWAP_KEY(keep,  5, k6), \
+    SWAP_KEY(keep, 6, k5),  SWAP_KEY(keep, 7, k4),  SWAP_KEY(keep,  8, k3), \
+    SWAP_KEY(keep, 9, k2),  SWAP_KEY(keep, 10, k1), SWAP_KEY(keep, 11, k0) }
+
+#define LAYER_ROW(row)            { SWAP_UNPAREN row }
+#define SWAP_LAYER_ROW(keep, row) SWAP_APPLY(SWAP_ROW, keep, SWAP_UNPAREN row)
+
+#define LAYER(rows)             LAYER_(rows)
+#define LAYER_(r0, r1, r2, r3)  { LAYER_ROW(r0), LAYER_ROW(r1), LAYER_ROW(r2), LAYER_ROW(r3) }
+
+#define SWAP_LAYER(rows)        SWAP_LAYER_(rows)
+#define SWAP_LAYER_(r0, r1, r2, r3) { \
+    SWAP_LAYER_ROW(SWAP_KEEP_0, r0), SWAP_LAYER_ROW(SWAP_KEEP_1, r1), \
+    SWAP_LAYER_ROW(SWAP_KEEP_2, r2), SWAP_LAYER_ROW(SWAP_KEEP_3, r3) }
+
+#endif
@@ -0,0 +1,242 @@
+#include "tap_hold.h"
+#include "matrix_ring.h"
+
+enum tap_hold_states {
+  TH_FREE = 0,
+  TH_PENDING,
+  TH_TAPPED,
+  TH_HELD,
+};
+
+typedef struct {
+  keypos_t key;
+  uint8_t  index;
+  uint8_t  state;
+} tap_hold_slot_t;
+
+static tap_hold_slot_t slots[TAP_HOLD_SLOTS];
+
+static tap_hold_slot_t *pending;
+static uint16_t pending_time;
+static uint16_t pending_term;
+
+// Events seen while a key is pending, oldest first
+static keyrecord_t queue[TAP_HOLD_QUEUE_SIZE];
+static uint8_t queue_len;
+static bool draining;
+
+// Regular key presses, for the typing streak; none yet after power up
+static uint16_t last_press_time;
+static bool last_press_seen;
+
+static void read_key(uint8_t index, tap_hold_key_t *th) {
+  memcpy_P(th, &tap_hold_keys[index], sizeof(tap_hold_key_t));
+}
+
+static tap_hold_slot_t *find_slot(keypos_t key) {
+  for (uint8_t i = 0; i < TAP_HOLD_SLOTS; i++) {
+    if (slots[i].state != TH_FREE && KEYEQ(slots[i].key, key)) {
+      return &slots[i];
+    }
+  }
+  return NULL;
+}
+
+static tap_hold_slot_t *alloc_slot(void) {
+  for (uint8_t i = 0; i < TAP_HOLD_SLOTS; i++) {
+    if (slots[i].state == TH_FREE) {
+      return &slots[i];
+    }
+  }
+  return NULL;
+}
+
+static void resolve(tap_hold_slot_t *slot, bool hold) {
+  tap_hold_key_t th;
+
+  read_key(slot->index, &th);
+  if (hold) {
+    if (th.mods) {
+      register_mods(th.mods);
+    } else {
+      layer_on(th.layer);
+    }
+    slot->state = TH_HELD;
+  } else {
+    register_code(th.tap);
+    slot->state = TH_TAPPED;
+  }
+  if (slot == pending) {
+    pending = NULL;
+  }
+}
+
+static void release(tap_hold_slot_t *slot) {
+  tap_hold_key_t th;
+
+  if (slot->state == TH_PENDING) {
+    resolve(slot, false);
+  }
+  read_key(slot->index, &th);
+  if (slot->state == TH_HELD) {
+    if (th.mods) {
+      unregister_mods(th.mods);
+    } else {
+      layer_off(th.layer);
+    }
+  } else {
+    unregister_code(th.tap);
+  }
+  slot->state = TH_FREE;
+}
+
+// Handles an event in order, with nothing pending ahead of it
+static bool handle(uint16_t keycode, keyrecord_t *record) {
+  tap_hold_slot_t *slot;
+  tap_hold_key_t th;
+
+  if (!IS_TAP_HOLD(keycode)) {
+    if (record->event.pressed) {
+      last_press_time = record->event.time;
+      last_press_seen = true;
+    }
+    return true;
+  }
+
+  if (!record->event.pressed) {
+    slot = find_slot(record->event.key);
+    if (slot) {
+      release(slot);
+    }
+    return false;
+  }
+
+  read_key(keycode - TAP_HOLD_RANGE, &th);
+  slot = alloc_slot();
+  if (!slot) {
+    // More dual-role keys down than slots: this one cannot be followed to its
+    // release, so it taps at once
+    register_code(th.tap);
+    unregister_code(th.tap);
+    return false;
+  }
+  slot->key = record->event.key;
+  slot->index = keycode - TAP_HOLD_RANGE;
+
+  if ((th.flags & TH_TYPING_STREAK) && last_press_seen &&
+      TIMER_DIFF_16(record->event.time, last_press_time) < TAP_HOLD_STREAK_TERM) {
+    resolve(slot, false);
+  } else {
+    slot->state = TH_PENDING;
+    pending = slot;
+    pending_time = record->event.time;
+    pending_term = th.term;
+  }
+  return false;
+}
+
+static bool pressed_in_queue(keypos_t key, uint8_t before) {
+  for (uint8_t i = 0; i < before; i++) {
+    if (queue[i].event.pressed && KEYEQ(queue[i].event.key, key)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Settles the pending key if the queued events decide it
+static void decide(void) {
+  tap_hold_key_t th;
+
+  read_key(pending->index, &th);
+  for (uint8_t i = 0; i < queue_len; i++) {
+    keyevent_t *event = &queue[i].event;
+
+    if (KEYEQ(event->key, pending->key)) {
+      resolve(pending, false);
+      return;
+    }
+    if (event->pressed) {
+      if (th.flags & TH_HOLD_ON_PRESS) {
+        resolve(pending, true);
+        return;
+      }
+    } else if ((th.flags & TH_PERMISSIVE_HOLD) && pressed_in_queue(event->key, i)) {
+      resolve(pending, true);
+      return;
+    }
+  }
+}
+
+// Replays queued events until the queue is empty or a key is pending again
+static void drain(void) {
+  keyrecord_t record;
+
+  while (queue_len) {
+    if (pending) {
+      decide();
+      if (pending) {
+        return;
+      }
+    }
+    record = queue[0];
+    queue_len--;
+    memmove(&queue[0], &queue[1], queue_len * sizeof(keyrecord_t));
+
+    draining = true;
+    process_record(&record);
+    draining = false;
+  }
+}
+
+bool process_tap_hold(uint16_t keycode, keyrecord_t *record) {
+  if (!draining) {
+    // Decide on when the scan saw the edge, not when the event got here
+    record->event.time = matrix_edge_time(record->event);
+  }
+
+  if (draining || (!pending && !queue_len)) {
+    return handle(keycode, record);
+  }
+
+  while (queue_len == TAP_HOLD_QUEUE_SIZE && pending) {
+    resolve(pending, true);
+    drain();
+  }
+  if (!pending && !queue_len) {
+    return handle(keycode, record);
+  }
+
+  queue[queue_len++] = *record;
+  drain();
+  return false;
+}
+
+void tap_hold_task(void) {
+  if (pending && timer_elapsed(pending_time) >= pending_term) {
+    resolve(pending, true);
+    drain();
+  }
+}
+
+bool tap_hold_idle(void) {
+  for (uint8_t i = 0; i < TAP_HOLD_SLOTS; i++) {
+    if (slots[i].state != TH_FREE) {
+      return false;
+    }
+  }
+  return !queue_len;
+}
+
+bool tap_hold_replaying(void) {
+  return draining;
+}
+
+// Events only queue up behind a pending key, so settling every key that turns
+// pending during the replay leaves the queue empty
+void tap_hold_settle(void) {
+  while (pending) {
+    resolve(pending, true);
+    drain();
+  }
+}
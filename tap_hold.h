@@ -0,0 +1,66 @@
+#ifndef TAP_HOLD_H
+#define TAP_HOLD_H
+
+#include "quantum.h"
+
+/*
+ * Tap/hold decision engine for dual-role keys
+ *
+ * A TH(n) key sends tap_hold_keys[n].tap when tapped and holds a modifier or a
+ * layer otherwise. Unlike MT()/LT(), each key carries its own tapping term and
+ * decision rules, and keys flagged TH_TYPING_STREAK resolve to tap at once when
+ * pressed right after a regular key, so they never wait out the term mid-word.
+ *
+ * Events that arrive while a key is undecided are queued and replayed through
+ * process_record() once it settles, so they see the final layer and mod state.
+ */
+
+#ifndef TAP_HOLD_STREAK_TERM
+#define TAP_HOLD_STREAK_TERM    100
+#endif
+
+#ifndef TAP_HOLD_SLOTS
+#define TAP_HOLD_SLOTS          4
+#endif
+
+#ifndef TAP_HOLD_QUEUE_SIZE
+#define TAP_HOLD_QUEUE_SIZE     8
+#endif
+
+#define TAP_HOLD_RANGE          (SAFE_RANGE + 0x100)
+#define TAP_HOLD_MAX            0x40
+#define TH(n)                   (TAP_HOLD_RANGE + (n))
+#define IS_TAP_HOLD(kc)         ((kc) >= TAP_HOLD_RANGE && (kc) < TAP_HOLD_RANGE + TAP_HOLD_MAX)
+
+/* Decision rules, checked while the key is pending */
+#define TH_PERMISSIVE_HOLD      0x01    // hold when another key is pressed and released inside the term
+#define TH_HOLD_ON_PRESS        0x02    // hold as soon as another key is pressed
+#define TH_TYPING_STREAK        0x04    // tap at once when pressed within TAP_HOLD_STREAK_TERM of a regular key
+
+typedef struct {
+  uint8_t  tap;                         // basic keycode sent on tap
+  uint8_t  mods;                        // modifiers held, 0 for a layer key
+  uint8_t  layer;                       // layer held when mods is 0
+  uint8_t  flags;
+  uint16_t term;
+} tap_hold_key_t;
+
+#define TAP_HOLD_MOD(kc, mod, term, flags)      { (kc), MOD_BIT(mod), 0, (flags), (term) }
+#define TAP_HOLD_LAYER(kc, layer, term, flags)  { (kc), 0, (layer), (flags), (term) }
+
+extern const tap_hold_key_t tap_hold_keys[];
+
+bool process_tap_hold(uint16_t keycode, keyrecord_t *record);
+void tap_hold_task(void);
+
+/* True when no key is down, pending or queued, so events need not go through
+ * process_tap_hold() */
+bool tap_hold_idle(void);
+
+/* Resolves pending keys as held and replays what was queued behind them */
+void tap_hold_settle(void);
+
+/* True while a queued event is replayed through process_record() */
+bool tap_hold_replaying(void);
+
+#endif
@@ -0,0 +1,102 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "tick.h"
+
+#define TICK_TOP        (F_CPU / 64UL * TICK_US / 1000000UL - 1)
+#define TICK_MASK       (TICK_TASKS - 1)
+
+typedef struct {
+  tick_task_t task;
+  uint16_t    period;   // slot visits
+  uint16_t    countdown;
+} tick_slot_t;
+
+static tick_slot_t slots[TICK_TASKS];
+static uint8_t next_slot;
+static uint8_t divider = 1;
+
+/* Timer 3 counts since the compare match */
+static volatile uint16_t isr_max;
+
+volatile uint16_t tick_late;
+
+// Samples a row before anything else so rows stay evenly spaced, then gives
+// one slot its turn. TCNT3 restarted at the compare match, so reading it at
+// the end gives the time taken including the interrupt entry.
+ISR(TIMER3_COMPA_vect) {
+  tick_slot_t *slot = &slots[next_slot];
+
+  next_slot = (next_slot + 1) & TICK_MASK;
+  matrix_ring_tick();
+  if (slot->task) {
+    if (slot->countdown > divider) {
+      slot->countdown -= divider;
+    } else {
+      slot->countdown = slot->period;
+      slot->task();
+    }
+  }
+
+  uint16_t elapsed = TCNT3;
+  if (TIFR3 & _BV(OCF3A)) {
+    tick_late++;
+  } else if (elapsed > isr_max) {
+    isr_max = elapsed;
+  }
+}
+
+void tick_init(void) {
+  // Timer 3 in CTC mode, clk/64, compare match A every tick
+  TCCR3A = 0;
+  TCCR3B = _BV(WGM32) | _BV(CS31) | _BV(CS30);
+  OCR3A = TICK_TOP;
+  TIMSK3 |= _BV(OCIE3A);
+}
+
+// A visit counts for divider visits at the normal rate. The new compare value
+// takes effect from the running count, restarted if already past it.
+void tick_set_divider(uint8_t d) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    divider = d;
+    OCR3A = (TICK_TOP + 1) * d - 1;
+    if (TCNT3 >= OCR3A) {
+      TCNT3 = 0;
+    }
+  }
+}
+
+bool tick_task_add(tick_task_t task, uint32_t period_us) {
+  uint16_t period = period_us / TICK_SLOT_US;
+
+  if (!period) {
+    period = 1;
+  }
+  for (uint8_t i = 0; i < TICK_TASKS; i++) {
+    if (!slots[i].task) {
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        slots[i].period = period;
+        slots[i].countdown = period;
+        slots[i].task = task;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+uint16_t tick_isr_max_us(void) {
+  uint16_t max;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    max = isr_max;
+  }
+  return max * 64 / (F_CPU / 1000000);
+}
+
+void tick_stats_clear(void) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    isr_max = 0;
+    tick_late = 0;
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef TICK_H
+#define TICK_H
+
+#include "quantum.h"
+#include "matrix_ring.h"
+
+/*
+ * Shared timer 3 tick service
+ *
+ * Timer 3 interrupts once per matrix row (TICK_US). Every tick first samples a
+ * row, then visits one slot of the task table, round robin. A tick therefore
+ * costs one row plus at most one task whatever the number of tasks, and each
+ * slot comes around once every TICK_TASKS ticks, which with the default scan
+ * rate is once per millisecond.
+ *
+ * Tasks run inside the interrupt: keep them to a few register writes.
+ */
+
+#define TICK_US                 (MATRIX_SCAN_US / MATRIX_ROWS)
+
+/* Must be a power of two */
+#ifndef TICK_TASKS
+#define TICK_TASKS              4
+#endif
+
+/* Time between two visits of the same slot */
+#define TICK_SLOT_US            ((uint32_t)TICK_US * TICK_TASKS)
+
+typedef void (*tick_task_t)(void);
+
+void tick_init(void);
+
+/* Runs task every period_us, rounded to whole slot visits. Returns false
+ * when the table is full. */
+bool tick_task_add(tick_task_t task, uint32_t period_us);
+
+/* Stretches the tick to divider * TICK_US, 1 for the normal rate. Tasks keep
+ * their period, give or take one stretched slot visit. */
+void tick_set_divider(uint8_t divider);
+
+/* Longest interrupt so far, compare match to return, in microseconds */
+uint16_t tick_isr_max_us(void);
+
+/* Ticks whose interrupt ran into the next one */
+extern volatile uint16_t tick_late;
+
+void tick_stats_clear(void);
+
+#endif
@@ -0,0 +1,250 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/crc16.h>
+#include "host.h"
+#include "host_driver.h"
+#include "timer.h"
+#include "util.h"
+#include "trace.h"
+
+#define TRACE_MASK      (TRACE_SIZE - 1)
+#define TRACE_VERSION   1
+#define DELTA_EXT       31
+#define DUMP_LINE       32      // bytes per typed line
+
+extern keymap_config_t keymap_config;
+
+/* Ring of whole records; base_time is the time the oldest delta counts from */
+static uint8_t buf[TRACE_SIZE];
+static uint16_t tail;
+static uint16_t used;
+static uint16_t base_time;
+static uint16_t last_time;
+
+static uint32_t last_layers;
+static uint32_t last_default;
+
+static host_driver_t *driver;
+static host_driver_t trace_driver;
+
+/* Dump being typed, one character per two scans. Recording stops meanwhile. */
+static bool dumping;
+static char header[16];
+static uint8_t header_len;
+static uint16_t dump_pos;       // header characters, then two per byte
+static bool dump_key_down;
+
+static uint8_t payload_len(uint8_t type) {
+  switch (type) {
+    case TRACE_RAW:
+    case TRACE_EDGE:
+    case TRACE_OVERRUN:
+    case TRACE_DEFAULT:
+      return 1;
+    case TRACE_LAYER:
+    case TRACE_REPORT:
+      return 2;
+  }
+  return 0;
+}
+
+static uint8_t at(uint16_t i) {
+  return buf[(tail + i) & TRACE_MASK];
+}
+
+static void drop_oldest(void) {
+  uint8_t head = at(0);
+  uint16_t delta = head & DELTA_EXT;
+  uint8_t len = 1 + payload_len(head >> 5);
+
+  if (delta == DELTA_EXT) {
+    delta = at(1) | (at(2) << 8);
+    len += 2;
+  }
+  base_time += delta;
+  tail = (tail + len) & TRACE_MASK;
+  used -= len;
+}
+
+static void put(uint8_t byte) {
+  buf[(tail + used++) & TRACE_MASK] = byte;
+}
+
+// Called from the tick interrupt as well as the main loop, so the time is read
+// with interrupts off and records always go in time order
+static void add(uint8_t type, uint16_t payload) {
+  uint8_t sreg = SREG;
+
+  cli();
+  if (!dumping) {
+    uint16_t now = timer_read();
+    uint16_t delta = now - last_time;
+    uint8_t n = payload_len(type);
+    uint8_t len = 1 + n + (delta >= DELTA_EXT ? 2 : 0);
+
+    while (TRACE_SIZE - used < len) {
+      drop_oldest();
+    }
+    last_time = now;
+    if (delta >= DELTA_EXT) {
+      put(type << 5 | DELTA_EXT);
+      put(delta);
+      put(delta >> 8);
+    } else {
+      put(type << 5 | delta);
+    }
+    if (n > 0) {
+      put(payload);
+    }
+    if (n > 1) {
+      put(payload >> 8);
+    }
+  }
+  SREG = sreg;
+}
+
+// The CRC covers what the host gets: the NKRO bitmap, or the six keys of a boot
+// report. host/replay prints the same one.
+static void send_keyboard(report_keyboard_t *report) {
+  const uint8_t *bytes = report->keys;
+  uint8_t len = 6;
+  uint8_t crc = 0;
+
+#ifdef NKRO_ENABLE
+  if (keyboard_protocol && keymap_config.nkro) {
+    bytes = report->nkro.bits;
+    len = KEYBOARD_REPORT_BITS;
+  }
+#endif
+  for (uint8_t i = 0; i < len; i++) {
+    crc = _crc8_ccitt_update(crc, bytes[i]);
+  }
+  add(TRACE_REPORT, report->raw[0] | (crc << 8));
+  driver->send_keyboard(report);
+}
+
+// Call before the other driver wrappers, so REPORT records what really goes out
+void trace_init(void) {
+  driver = host_get_driver();
+  trace_driver = *driver;
+  trace_driver.send_keyboard = send_keyboard;
+  host_set_driver(&trace_driver);
+
+  base_time = last_time = timer_read();
+}
+
+void trace_key(uint8_t type, uint8_t key) {
+  add(type, key);
+}
+
+static char hex_digit(uint8_t n) {
+  return n < 10 ? '0' + n : 'a' + n - 10;
+}
+
+static void append_hex(uint16_t value) {
+  for (int8_t shift = 12; shift >= 0; shift -= 4) {
+    header[header_len++] = hex_digit((value >> shift) & 0xF);
+  }
+}
+
+// Line one: version, start time in ms and length, then DUMP_LINE bytes a line
+static char dump_char(void) {
+  uint16_t i;
+  uint8_t byte;
+
+  if (dump_pos < header_len) {
+    return header[dump_pos];
+  }
+  i = dump_pos - header_len;
+  if (i % (DUMP_LINE * 2 + 1) == DUMP_LINE * 2) {
+    return '\n';
+  }
+  i -= i / (DUMP_LINE * 2 + 1);
+  if (i / 2 >= used) {
+    return '\n';
+  }
+  byte = at(i / 2);
+  return hex_digit(i & 1 ? byte & 0xF : byte >> 4);
+}
+
+static uint16_t dump_len(void) {
+  uint16_t digits = used * 2;
+
+  return header_len + digits + (digits ? (digits - 1) / (DUMP_LINE * 2) : 0) + 1;
+}
+
+static void type_dump(void) {
+  char c = dump_char();
+  uint8_t code;
+
+  if (c == ' ') {
+    code = KC_SPC;
+  } else if (c == '\n') {
+    code = KC_ENT;
+  } else if (c == '0') {
+    code = KC_0;
+  } else if (c <= '9') {
+    code = KC_1 + (c - '1');
+  } else {
+    code = KC_A + (c - 'a');
+  }
+
+  if (!dump_key_down) {
+    register_code(code);
+  } else {
+    unregister_code(code);
+    dump_pos++;
+  }
+  dump_key_down = !dump_key_down;
+}
+
+static void dump_done(void) {
+  uint8_t sreg = SREG;
+
+  cli();
+  used = 0;
+  base_time = last_time = timer_read();
+  dumping = false;
+  SREG = sreg;
+}
+
+void trace_task(void) {
+  if (dumping) {
+    if (dump_pos < dump_len()) {
+      type_dump();
+    } else {
+      dump_done();
+    }
+    return;
+  }
+
+  if (layer_state != last_layers) {
+    last_layers = layer_state;
+    add(TRACE_LAYER, layer_state);
+  }
+  if (default_layer_state != last_default) {
+    last_default = default_layer_state;
+    add(TRACE_DEFAULT, biton32(default_layer_state));
+  }
+}
+
+void trace_dump(void) {
+  uint8_t sreg = SREG;
+
+  if (dumping) {
+    return;
+  }
+  cli();
+  dumping = true;
+  SREG = sreg;
+
+  header_len = 0;
+  header[header_len++] = '0' + TRACE_VERSION;
+  header[header_len++] = ' ';
+  append_hex(base_time);
+  header[header_len++] = ' ';
+  append_hex(used);
+  header[header_len++] = '\n';
+  dump_pos = 0;
+  dump_key_down = false;
+}
@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "quantum.h"
+
+/*
+ * Keystroke trace recorder
+ *
+ * Built only with TRACE_ENABLE = yes; otherwise every hook below compiles to
+ * nothing. A RAM ring keeps the most recent events, oldest dropped first:
+ *
+ *   RAW      a column changed level on a row read, before debounce
+ *   EDGE     a debounced edge went into the matrix ring
+ *   OVERRUN  the matrix ring filled up and an edge had to wait
+ *   LAYER    layer_state changed (low 16 bits), tri-layer included
+ *   DEFAULT  the default layer changed (layer number)
+ *   REPORT   a keyboard report went to the host (mods, CRC-8 of the NKRO
+ *            bitmap or of the six boot report keys)
+ *
+ * Each record is a header byte, type << 5 | ms since the previous record,
+ * followed by the payload. A gap of 31 ms or more stores 31 and the real gap
+ * in the next two bytes; gaps over 65 s wrap like timer_read(). Key payloads
+ * are one byte, pressed << 7 | row << 4 | col, so a key edge costs two bytes
+ * and 512 bytes hold the last 250 or so edges.
+ *
+ * The TRACE key types the ring as hex and empties it. trace_decode.py turns
+ * the typed text back into one event per line, for reading or replaying.
+ */
+
+#ifndef TRACE_SIZE
+#define TRACE_SIZE              512     // bytes, a power of two
+#endif
+
+enum trace_types {
+  TRACE_RAW,
+  TRACE_EDGE,
+  TRACE_OVERRUN,
+  TRACE_LAYER,
+  TRACE_DEFAULT,
+  TRACE_REPORT,
+};
+
+#ifdef TRACE_ENABLE
+
+void trace_init(void);
+void trace_task(void);
+void trace_key(uint8_t type, uint8_t key);
+void trace_dump(void);
+
+#else
+
+#define trace_init()
+#define trace_task()
+#define trace_key(type, key)
+#define trace_dump()
+
+#endif
+
+#endif
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+#
+# Decodes the text typed by the TRACE key (see trace.h) into one event per
+# line, times in ms from the start of the trace:
+#
+#   ./trace_decode.py < dump.txt
+#
+# With --replay only the debounced edges are kept, as "<ms> <row> <col> <0|1>",
+# followed by the default layer and the reports the board sent as comments. Fed
+# to host/replay, the edges should reproduce the same reports; the trace does
+# not hold the board's eeconfig, so NKRO or a swapped Alt/Gui have to be given
+# as "eeprom <addr> <value>" lines in front. make check in host/ does this
+# round trip for the streams in DUMPED.
+#
+import re
+import sys
+
+TYPES = ["raw", "edge", "overrun", "layer", "default", "report"]
+PAYLOAD = [1, 1, 1, 2, 1, 2]
+DELTA_EXT = 31
+
+
+# Whatever was typed before the dump, in the same editor, is skipped
+def parse(text):
+    headers = list(re.finditer(r"1 ([0-9a-f]{4}) ([0-9a-f]{4})\n", text))
+    if not headers:
+        sys.exit("not a version 1 trace")
+    start = int(headers[-1].group(1), 16)
+    length = int(headers[-1].group(2), 16)
+    data = bytes.fromhex("".join(text[headers[-1].end():].split()))
+    if len(data) != length:
+        sys.exit("trace is %d bytes, header says %d" % (len(data), length))
+    return start, data
+
+
+def records(data):
+    time = 0
+    i = 0
+    while i < len(data):
+        kind = data[i] >> 5
+        delta = data[i] & DELTA_EXT
+        i += 1
+        if delta == DELTA_EXT:
+            delta = data[i] | data[i + 1] << 8
+            i += 2
+        n = PAYLOAD[kind]
+        payload = int.from_bytes(data[i:i + n], "little")
+        i += n
+        time += delta
+        yield time, kind, payload
+
+
+def key(payload):
+    return (payload >> 4) & 0x07, payload & 0x0F, payload >> 7
+
+
+def describe(kind, payload):
+    name = TYPES[kind]
+    if name in ("raw", "edge", "overrun"):
+        row, col, pressed = key(payload)
+        return "%s %d %d %s" % (name, row, col, "down" if pressed else "up")
+    if name == "layer":
+        return "layer %04x" % payload
+    if name == "report":
+        return "report %02x %02x" % (payload & 0xFF, payload >> 8)
+    return "%s %d" % (name, payload)
+
+
+def main():
+    start, data = parse(sys.stdin.read())
+    replay = "--replay" in sys.argv[1:]
+
+    print("# start %d ms" % start)
+    for time, kind, payload in records(data):
+        if not replay:
+            print("%d %s" % (time, describe(kind, payload)))
+        elif TYPES[kind] == "edge":
+            print("%d %d %d %d" % ((time,) + key(payload)))
+        elif TYPES[kind] in ("report", "default"):
+            print("# %d %s" % (time, describe(kind, payload)))
+
+
+if __name__ == "__main__":
+    main()